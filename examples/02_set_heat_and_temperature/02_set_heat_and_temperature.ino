@@ -17,7 +17,7 @@ void setup()
     {
         wyt->setPowerOn(true);
         wyt->setMode(OpMode::Heat);
-        wyt->setChosenTemperature(24.0);
+        wyt->setChosenTemperature(WYT_DEGREES_C(24.0));
         wyt->applySettings();
     }
     delay(4000);
@@ -0,0 +1,123 @@
+#include <Arduino.h>
+#include "pioneer_uart.h"
+#include "state_serializer.h"
+
+using namespace pioneer_uart;
+
+#define ITERATIONS 1000
+
+// A state response, with the length and checksum a unit sends, so the benchmark runs without a unit attached
+static const uint8_t SAMPLE_STATE[RESPONSE_SIZE] = {
+    0xbb, 0x01, 0x00, 0x04, 0x37, 0x00, 0x00, 0x14, 0x18, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x6b, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7d, 0x00,
+    0x00, 0x00, 0x55, 0x0c, 0x14, 0x32, 0x2a, 0x28, 0x4a, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x04, 0x00,
+    0x00, 0x00, 0x00, 0x08, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xd5};
+
+PioneerWYT wyt;
+
+String getterJson()
+{
+    String json = "{\"power\":";
+    json += wyt.isPowerOn() ? "true" : "false";
+    json += ",\"eco\":";
+    json += wyt.isEco() ? "true" : "false";
+    json += ",\"display\":";
+    json += wyt.isDisplayOn() ? "true" : "false";
+    json += ",\"strong\":";
+    json += wyt.isStrong() ? "true" : "false";
+    json += ",\"health\":";
+    json += wyt.isHealth() ? "true" : "false";
+    json += ",\"mute\":";
+    json += wyt.isMute() ? "true" : "false";
+    json += ",\"vertical_flow\":";
+    json += wyt.isVerticalFlow() ? "true" : "false";
+    json += ",\"horizontal_flow\":";
+    json += wyt.isHorizontalFlow() ? "true" : "false";
+    json += ",\"four_way_valve_on\":";
+    json += wyt.isFourWayValveOn() ? "true" : "false";
+    json += ",\"antifreeze\":";
+    json += wyt.isAntifreeze() ? "true" : "false";
+    json += ",\"heat_mode\":";
+    json += wyt.isHeatMode() ? "true" : "false";
+    json += ",\"mode\":";
+    json += String(static_cast<int>(wyt.getMode()));
+    json += ",\"chosen_fan_speed\":";
+    json += String(static_cast<int>(wyt.getChosenFanSpeed()));
+    json += ",\"chosen_temperature\":";
+    json += String(wyt.getChosenTemperature(), 1);
+    json += ",\"indoor_temperature\":";
+    json += String(wyt.getIndoorTemperature(), 1);
+    json += ",\"indoor_heat_exchanger_temperature\":";
+    json += String(wyt.getIndoorHeatExchangerTemperature(), 1);
+    json += ",\"outdoor_temperature\":";
+    json += String(wyt.getOutdoorTemperature(), 0);
+    json += ",\"condenser_coil_temperature\":";
+    json += String(wyt.getCondenserCoilTemperature(), 0);
+    json += ",\"compressor_discharge_temperature\":";
+    json += String(wyt.getCompressorDischargeTemperature(), 0);
+    json += ",\"compressor_frequency\":";
+    json += String(wyt.getCompressorFrequency());
+    json += ",\"indoor_fan_speed\":";
+    json += String(static_cast<int>(wyt.getIndoorFanSpeed()));
+    json += ",\"outdoor_fan_speed\":";
+    json += String(wyt.getOutdoorFanSpeed());
+    json += ",\"supply_voltage\":";
+    json += String(wyt.getSupplyVoltage());
+    json += ",\"current_used_amps\":";
+    json += String(wyt.getCurrentUsedAmps());
+    json += ",\"up_down_flow\":";
+    json += String(static_cast<int>(wyt.getUpDownFlow()));
+    json += ",\"left_right_flow\":";
+    json += String(static_cast<int>(wyt.getLeftRightFlow()));
+    json += ",\"sleep_mode\":";
+    json += String(static_cast<int>(wyt.getSleepMode()));
+    json += "}";
+    return json;
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    wyt.deserializeState(SAMPLE_STATE);
+}
+
+void loop()
+{
+    size_t total = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        total += getterJson().length();
+    }
+    unsigned long getter_us = micros() - start;
+
+    char json[640];
+    start = micros();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        total += serializer::to_json(wyt.getRawState(), json, sizeof(json));
+    }
+    unsigned long json_us = micros() - start;
+
+    uint8_t cbor[512];
+    start = micros();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        total += serializer::to_cbor(wyt.getRawState(), cbor, sizeof(cbor));
+    }
+    unsigned long cbor_us = micros() - start;
+
+    Serial.print("getters + String: ");
+    Serial.print(getter_us / ITERATIONS);
+    Serial.println(" us/state");
+    Serial.print("to_json: ");
+    Serial.print(json_us / ITERATIONS);
+    Serial.println(" us/state");
+    Serial.print("to_cbor: ");
+    Serial.print(cbor_us / ITERATIONS);
+    Serial.println(" us/state");
+    Serial.print("(checksum ");
+    Serial.print(total);
+    Serial.println(")");
+    delay(10000);
+}
@@ -0,0 +1,41 @@
+#include <Arduino.h>
+#include "pioneer_uart.h"
+#include "wyt_scene.h"
+
+using namespace pioneer_uart;
+
+// Built entirely at compile time, and kept in flash
+constexpr command::SceneFrame ALL_OFF PROGMEM = command::Scene().power(false).frame();
+constexpr command::SceneFrame COOL_24 PROGMEM =
+    command::Scene().power(true).mode(command::OpMode::Cool).temperature(24).fanSpeed(command::FanSpeed::Auto).frame();
+constexpr command::SceneFrame HEAT_21_SLEEP PROGMEM =
+    command::Scene().power(true).mode(command::OpMode::Heat).temperature(21).sleep(command::SleepMode::Standard).frame();
+
+PioneerWYT *wyt;
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial1.begin(9600, SERIAL_8E1);
+
+    wyt = new PioneerWYT(Serial1);
+}
+
+void loop()
+{
+    if (!wyt->sendFrame_P(COOL_24.bytes))
+    {
+        Serial.println("Failed to send cool scene");
+    }
+    delay(60000);
+    if (!wyt->sendFrame_P(HEAT_21_SLEEP.bytes))
+    {
+        Serial.println("Failed to send heat scene");
+    }
+    delay(60000);
+    if (!wyt->sendFrame_P(ALL_OFF.bytes))
+    {
+        Serial.println("Failed to send off scene");
+    }
+    delay(60000);
+}
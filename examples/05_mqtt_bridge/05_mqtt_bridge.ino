@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include <PubSubClient.h>
+#include "pioneer_uart.h"
+#include "mqtt_bridge.h"
+
+using namespace pioneer_uart;
+
+#define WIFI_SSID "my-network"
+#define WIFI_PASSWORD "my-password"
+#define MQTT_HOST "192.168.1.10"
+#define POLL_INTERVAL_MS 5000
+
+/** Adapts PubSubClient to the interface the bridge publishes and subscribes with */
+class PubSubMqttClient : public MqttClient
+{
+public:
+    explicit PubSubMqttClient(PubSubClient &client) : m_client(client) {}
+    bool publish(const char *topic, const char *payload, size_t length, bool retain) override
+    {
+        return m_client.publish(topic, reinterpret_cast<const uint8_t *>(payload), length, retain);
+    }
+    bool subscribe(const char *topic_filter) override
+    {
+        return m_client.subscribe(topic_filter);
+    }
+
+private:
+    PubSubClient &m_client;
+};
+
+WiFiClient wifi;
+PubSubClient mqtt(wifi);
+PubSubMqttClient mqtt_client(mqtt);
+MqttBridge bridge(mqtt_client, "pioneer/living_room");
+PioneerWYT *wyt;
+uint32_t last_poll_ms = 0;
+
+void onMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    bridge.handleMessage(topic, payload, length, millis());
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial1.begin(9600, SERIAL_8E1);
+    wyt = new PioneerWYT(Serial1);
+
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    mqtt.setServer(MQTT_HOST, 1883);
+    mqtt.setCallback(onMessage);
+    // The full state and the discovery config are bigger than PubSubClient's default packet size
+    mqtt.setBufferSize(MQTT_BRIDGE_BUFFER_SIZE + MQTT_BRIDGE_MAX_TOPIC_SIZE + 8);
+}
+
+void loop()
+{
+    if (!mqtt.connected())
+    {
+        if (WiFi.status() != WL_CONNECTED || !mqtt.connect("pioneer-living-room"))
+        {
+            delay(1000);
+            return;
+        }
+        bridge.begin();
+        bridge.publishDiscovery("pioneer_living_room", "Living room");
+    }
+    mqtt.loop();
+
+    if (millis() - last_poll_ms >= POLL_INTERVAL_MS)
+    {
+        last_poll_ms = millis();
+        wyt->pollState();
+    }
+    bridge.loop(*wyt, millis());
+}
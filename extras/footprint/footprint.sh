@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# Reports the flash and RAM used by the library in each configuration of `pioneer_uart_config.h`, by building
+# `footprint_probe.cpp` with the host compiler and, if it is installed, avr-gcc. Sizes are of the probe minus an
+# empty program built the same way, so they are the library's (and the probe's) own share.
+#
+# Usage:
+#   footprint.sh [-c previous_report] > report
+#
+# Each report line is: toolchain, configuration, flash bytes, RAM bytes. With `-c`, the sizes are compared with an
+# earlier report, and the script fails if any configuration got bigger.
+#
+# Environment:
+#   CXX        host compiler (default g++)
+#   AVR_CXX    AVR compiler (default avr-g++)
+#   AVR_MCU    AVR target (default atmega328p)
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT="$HERE/../.."
+CXX=${CXX:-g++}
+AVR_CXX=${AVR_CXX:-avr-g++}
+AVR_MCU=${AVR_MCU:-atmega328p}
+SOURCES="$ROOT/src/pioneer_uart.cpp $ROOT/src/wyt_command.cpp $ROOT/src/wyt_response.cpp $ROOT/src/state_store.cpp"
+CXXFLAGS="-std=gnu++11 -Os -ffunction-sections -fdata-sections -fno-exceptions -fno-rtti -Wl,--gc-sections"
+
+PREVIOUS=
+if [ "$1" = "-c" ]; then
+  PREVIOUS=$2
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# name:flags, with flags comma separated
+CONFIGS="default:
+read_only:-DPIONEER_UART_READ_ONLY
+basic_setters:-DPIONEER_UART_BASIC_SETTERS
+fixed_point:-DPIONEER_UART_FIXED_POINT
+no_validation:-DPIONEER_UART_NO_VALIDATION
+minimal:-DPIONEER_UART_READ_ONLY,-DPIONEER_UART_FIXED_POINT,-DPIONEER_UART_NO_VALIDATION"
+
+# Prints "flash ram" for a binary, from the Berkeley format output of `size`
+sizes() {
+  "$1" "$2" | awk 'NR == 2 { print $1 + $2, $2 + $3 }'
+}
+
+# measure toolchain compiler size_tool extra_flags
+measure() {
+  "$2" $CXXFLAGS $4 -I"$ROOT/include" -DFOOTPRINT_EMPTY "$HERE/footprint_probe.cpp" -o "$WORK/empty"
+  set -- "$1" "$2" "$3" "$4" $(sizes "$3" "$WORK/empty")
+  echo "$CONFIGS" | while IFS=: read -r name flags; do
+    flags=$(echo "$flags" | tr ',' ' ')
+    "$2" $CXXFLAGS $4 $flags -I"$ROOT/include" "$HERE/footprint_probe.cpp" $SOURCES -o "$WORK/probe"
+    sizes "$3" "$WORK/probe" | {
+      read -r flash ram
+      echo "$1 $name $((flash - $5)) $((ram - $6))"
+    }
+  done
+}
+
+{
+  measure host "$CXX" size ""
+  if command -v "$AVR_CXX" > /dev/null 2>&1; then
+    measure "avr-$AVR_MCU" "$AVR_CXX" avr-size "-mmcu=$AVR_MCU"
+  else
+    echo "$AVR_CXX not found, skipping AVR sizes" >&2
+  fi
+} > "$WORK/report"
+
+cat "$WORK/report"
+
+if [ -n "$PREVIOUS" ]; then
+  awk 'NR == FNR { flash[$1 " " $2] = $3; ram[$1 " " $2] = $4; next }
+       ($1 " " $2) in flash && ($3 > flash[$1 " " $2] || $4 > ram[$1 " " $2]) {
+         printf "%s %s grew: flash %d -> %d, RAM %d -> %d\n", $1, $2, flash[$1 " " $2], $3, ram[$1 " " $2], $4 > "/dev/stderr"
+         grew = 1
+       }
+       END { exit grew }' "$PREVIOUS" "$WORK/report"
+fi
@@ -0,0 +1,106 @@
+/*
+ * A stand-in application for `footprint.sh`: it polls a unit, reads every decoded field and, when the configuration
+ * allows, changes every setting, so that everything the configuration includes is linked and can be measured.
+ * Bytes go to and from a volatile "register" rather than a real UART, so that the only code measured is the
+ * library's. Built with `FOOTPRINT_EMPTY` defined, it leaves the library out, to measure the runtime alone.
+ */
+#include "pioneer_uart.h"
+
+#ifdef __AVR__
+// Bare avr-gcc has no C++ runtime. Nothing here is deleted, but virtual destructors still refer to these.
+void operator delete(void *) {}
+void operator delete(void *, size_t) {}
+extern "C" void __cxa_pure_virtual()
+{
+  while (1)
+  {
+  }
+}
+#endif
+
+using namespace pioneer_uart;
+
+volatile uint8_t g_uart;
+volatile uint8_t g_sink;
+volatile DegreesC g_sink_degrees;
+
+#ifndef FOOTPRINT_EMPTY
+namespace
+{
+  struct ProbeTransport
+  {
+    size_t write(const uint8_t *bytes, size_t length)
+    {
+      for (size_t i = 0; i < length; ++i)
+      {
+        g_uart = bytes[i];
+      }
+      return length;
+    }
+    void flush() {}
+    size_t read(uint8_t *bytes, size_t length)
+    {
+      for (size_t i = 0; i < length; ++i)
+      {
+        bytes[i] = g_uart;
+      }
+      return length;
+    }
+  };
+
+  BasicPioneerWYT<ProbeTransport> g_unit{ProbeTransport()};
+}
+#endif
+
+int main()
+{
+#ifndef FOOTPRINT_EMPTY
+  if (!g_unit.pollState())
+  {
+    return 1;
+  }
+  g_sink = g_unit.isPowerOn() | g_unit.isEco() << 1 | g_unit.isDisplayOn() << 2 | g_unit.isStrong() << 3 |
+           g_unit.isHealth() << 4 | g_unit.isMute() << 5 | g_unit.isVerticalFlow() << 6 |
+           g_unit.isHorizontalFlow() << 7;
+  g_sink = g_unit.isFourWayValveOn() | g_unit.isAntifreeze() << 1 | g_unit.isHeatMode() << 2;
+  g_sink = static_cast<uint8_t>(g_unit.getMode());
+  g_sink = static_cast<uint8_t>(g_unit.getChosenFanSpeed());
+  g_sink = static_cast<uint8_t>(g_unit.getIndoorFanSpeed());
+  g_sink = static_cast<uint8_t>(g_unit.getUpDownFlow());
+  g_sink = static_cast<uint8_t>(g_unit.getLeftRightFlow());
+  g_sink = static_cast<uint8_t>(g_unit.getSleepMode());
+  g_sink = g_unit.getCompressorFrequency();
+  g_sink = g_unit.getOutdoorFanSpeed();
+  g_sink = g_unit.getSupplyVoltage();
+  g_sink = g_unit.getCurrentUsedAmps();
+  g_sink_degrees = g_unit.getChosenTemperature();
+  g_sink_degrees = g_unit.getIndoorTemperature();
+  g_sink_degrees = g_unit.getIndoorHeatExchangerTemperature();
+  g_sink_degrees = g_unit.getOutdoorTemperature();
+  g_sink_degrees = g_unit.getCondenserCoilTemperature();
+  g_sink_degrees = g_unit.getCompressorDischargeTemperature();
+
+#ifndef PIONEER_UART_READ_ONLY
+  uint8_t setting = g_uart;
+  g_unit.setPowerOn(setting & 1);
+  g_unit.setMode(static_cast<OpMode>(setting));
+  g_unit.setChosenFanSpeed(static_cast<FanSpeed>(setting));
+  g_unit.setChosenTemperature(g_sink_degrees);
+#ifndef PIONEER_UART_BASIC_SETTERS
+  g_unit.setEco(setting & 2);
+  g_unit.setDisplayOn(setting & 4);
+  g_unit.setStrong(setting & 8);
+  g_unit.setHealth(setting & 16);
+  g_unit.setMute(setting & 32);
+  g_unit.setUpDownFlow(static_cast<UpDownFlow>(setting));
+  g_unit.setLeftRightFlow(static_cast<LeftRightFlow>(setting));
+  g_unit.setSleepMode(static_cast<SleepMode>(setting));
+#endif
+  if (!g_unit.applySettings())
+  {
+    return 1;
+  }
+#endif
+#endif
+  return 0;
+}
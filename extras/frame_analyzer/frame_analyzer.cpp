@@ -0,0 +1,515 @@
+/*
+ * Offline analysis of captured WYT frames, to help work out what the `unknown*` fields of `WytResponse` and
+ * `WytSetStateCommand` mean.
+ *
+ * For every bit and byte that is not yet understood, it counts how often the value is set and how often it changes
+ * between consecutive frames, and correlates it against each of the decoded fields. Candidates are then ranked by
+ * the strength of their best correlation. Frames are split across threads, each accumulating means and sums of
+ * squared and cross deviations from them (Welford's method), which are merged pairwise at the end (Chan et al.),
+ * so correlations of values with large offsets do not cancel out over long captures.
+ *
+ * Build on a host with:
+ *   g++ -std=c++11 -O2 -pthread -I../../include frame_analyzer.cpp -o frame_analyzer
+ *
+ * Usage:
+ *   frame_analyzer [-t response|command] [--trace] [-j threads] [-n top] capture.bin
+ *
+ * The capture is either raw frames back to back, or with `--trace`, a dump from `WireTracer`, in which case
+ * received frames are analyzed for `-t response` and sent state commands for `-t command`.
+ */
+#include "wyt_response.h"
+#include "wyt_command.h"
+#include "wire_trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  typedef double (*Extractor)(const uint8_t *frame);
+
+  /** A field whose meaning is known, to correlate unknown bits and bytes against */
+  struct KnownField
+  {
+    const char *name;
+    Extractor value;
+  };
+
+  struct Schema
+  {
+    const char *name;
+    size_t frame_size;
+    const KnownField *fields;
+    size_t field_count;
+    /** Bits set for every bit of the frame that belongs to an `unknown*` field */
+    std::vector<uint8_t> unknown_mask;
+  };
+
+  inline const response::WytResponse &as_response(const uint8_t *frame)
+  {
+    return *reinterpret_cast<const response::WytResponse *>(frame);
+  }
+
+  inline const command::WytSetStateCommand &as_command(const uint8_t *frame)
+  {
+    return *reinterpret_cast<const command::WytSetStateCommand *>(frame);
+  }
+
+  const KnownField RESPONSE_FIELDS[] = {
+      {"power", [](const uint8_t *f) -> double { return as_response(f).power; }},
+      {"mode=cool", [](const uint8_t *f) -> double { return as_response(f).mode == response::OpMode::Cool; }},
+      {"mode=fan", [](const uint8_t *f) -> double { return as_response(f).mode == response::OpMode::Fan; }},
+      {"mode=dehumidify", [](const uint8_t *f) -> double { return as_response(f).mode == response::OpMode::Dehumidify; }},
+      {"mode=heat", [](const uint8_t *f) -> double { return as_response(f).mode == response::OpMode::Heat; }},
+      {"mode=auto", [](const uint8_t *f) -> double { return as_response(f).mode == response::OpMode::Auto; }},
+      {"eco", [](const uint8_t *f) -> double { return as_response(f).eco; }},
+      {"strong", [](const uint8_t *f) -> double { return as_response(f).strong; }},
+      {"display", [](const uint8_t *f) -> double { return as_response(f).display; }},
+      {"health", [](const uint8_t *f) -> double { return as_response(f).health; }},
+      {"fan_speed", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_response(f).fan_speed); }},
+      {"chosen_temperature", [](const uint8_t *f) -> double { return response::get_chosen_temperature_degrees_c(as_response(f)); }},
+      {"sleep", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_response(f).sleep); }},
+      {"four_way_valve_on", [](const uint8_t *f) -> double { return as_response(f).four_way_valve_on; }},
+      {"heat_mode", [](const uint8_t *f) -> double { return as_response(f).heat_mode; }},
+      {"antifreeze", [](const uint8_t *f) -> double { return as_response(f).antifreeze; }},
+      {"indoor_temp", [](const uint8_t *f) -> double { return as_response(f).indoor_temp_base; }},
+      {"indoor_heat_exchanger_temp", [](const uint8_t *f) -> double { return as_response(f).indoor_heat_exchanger_temp; }},
+      {"outdoor_temp", [](const uint8_t *f) -> double { return as_response(f).outdoor_temp; }},
+      {"condenser_coil_temp", [](const uint8_t *f) -> double { return as_response(f).condenser_coil_temp; }},
+      {"compressor_discharge_temp", [](const uint8_t *f) -> double { return as_response(f).compressor_discharge_temp; }},
+      {"compressor_frequency", [](const uint8_t *f) -> double { return as_response(f).compressor_frequency; }},
+      {"indoor_fan_speed", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_response(f).indoor_fan_speed); }},
+      {"outdoor_fan_speed", [](const uint8_t *f) -> double { return as_response(f).outdoor_fan_speed; }},
+      {"supply_voltage", [](const uint8_t *f) -> double { return as_response(f).supply_voltage; }},
+      {"current_used_amps", [](const uint8_t *f) -> double { return as_response(f).current_used_amps; }},
+  };
+
+  const KnownField COMMAND_FIELDS[] = {
+      {"power", [](const uint8_t *f) -> double { return as_command(f).power; }},
+      {"mode=heat", [](const uint8_t *f) -> double { return as_command(f).mode == command::OpMode::Heat; }},
+      {"mode=dehumidify", [](const uint8_t *f) -> double { return as_command(f).mode == command::OpMode::Dehumidify; }},
+      {"mode=cool", [](const uint8_t *f) -> double { return as_command(f).mode == command::OpMode::Cool; }},
+      {"mode=fan", [](const uint8_t *f) -> double { return as_command(f).mode == command::OpMode::Fan; }},
+      {"mode=auto", [](const uint8_t *f) -> double { return as_command(f).mode == command::OpMode::Auto; }},
+      {"eco", [](const uint8_t *f) -> double { return as_command(f).eco; }},
+      {"display", [](const uint8_t *f) -> double { return as_command(f).display; }},
+      {"beeper", [](const uint8_t *f) -> double { return as_command(f).beeper; }},
+      {"mute", [](const uint8_t *f) -> double { return as_command(f).mute; }},
+      {"strong", [](const uint8_t *f) -> double { return as_command(f).strong; }},
+      {"health", [](const uint8_t *f) -> double { return as_command(f).health; }},
+      {"antifreeze", [](const uint8_t *f) -> double { return as_command(f).antifreeze; }},
+      {"fan_speed", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_command(f).fan_speed); }},
+      {"set_temperature_whole", [](const uint8_t *f) -> double { return as_command(f).set_temperature_whole; }},
+      {"set_temperature_half", [](const uint8_t *f) -> double { return as_command(f).set_temperature_half; }},
+      {"sleep", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_command(f).sleep); }},
+      {"up_down_flow", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_command(f).up_down_flow); }},
+      {"left_right_flow", [](const uint8_t *f) -> double { return static_cast<uint8_t>(as_command(f).left_right_flow); }},
+  };
+
+  Schema response_schema()
+  {
+    // Mark unknown bits by setting every unknown field to all ones in an otherwise empty frame
+    response::WytResponse mask;
+    memset(mask.bytes, 0, RESPONSE_SIZE);
+    memset(mask.unknown1, 0xff, sizeof(mask.unknown1));
+    mask.unknown2 = 1;
+    mask.unknown3 = 1;
+    mask.unknown6 = 0x1f;
+    mask.unknown7 = 1;
+    mask.unknown9 = 1;
+    mask.unknown10 = 0x1f;
+    memset(mask.unknown11, 0xff, sizeof(mask.unknown11));
+    mask.unknown12 = 0xff;
+    mask.unknown13 = 0x1f;
+    memset(mask.unknown14, 0xff, sizeof(mask.unknown14));
+    mask.unknown15 = 0xff;
+    mask.unknown16 = 0x7f;
+    mask.unknown17 = 0x7f;
+    mask.unknown18 = 1;
+    mask.unknown19 = 0x3;
+    memset(mask.unknown20, 0xff, sizeof(mask.unknown20));
+    memset(mask.unknown21, 0xff, sizeof(mask.unknown21));
+    memset(mask.unknown22, 0xff, sizeof(mask.unknown22));
+    Schema schema = {"response", RESPONSE_SIZE, RESPONSE_FIELDS, sizeof(RESPONSE_FIELDS) / sizeof(RESPONSE_FIELDS[0]),
+                     std::vector<uint8_t>(mask.bytes, mask.bytes + RESPONSE_SIZE)};
+    return schema;
+  }
+
+  Schema command_schema()
+  {
+    command::WytSetStateCommand mask;
+    memset(mask.bytes, 0, STATE_COMMAND_SIZE);
+    memset(mask.unknown1, 0xff, sizeof(mask.unknown1));
+    mask.unknown2 = 1;
+    mask.unknown3 = 0x3;
+    mask.unknown4 = 1;
+    mask.unknown5 = 1;
+    mask.unknown6 = 0x1f;
+    mask.unknown7 = 0x3;
+    memset(mask.unknown8, 0xff, sizeof(mask.unknown8));
+    memset(mask.unknown9, 0xff, sizeof(mask.unknown9));
+    // `vertical_flow` in commands is only a guess so far
+    mask.vertical_flow = 0x7;
+    Schema schema = {"command", STATE_COMMAND_SIZE, COMMAND_FIELDS, sizeof(COMMAND_FIELDS) / sizeof(COMMAND_FIELDS[0]),
+                     std::vector<uint8_t>(mask.bytes, mask.bytes + STATE_COMMAND_SIZE)};
+    return schema;
+  }
+
+  /** Running moments for correlating one unknown value with every known field */
+  struct Sums
+  {
+    uint64_t changes = 0;
+    double mean = 0;
+    /** Sum of squared deviations from the mean */
+    double m2 = 0;
+    /** Sums of products of deviations from this value's mean and from each field's mean */
+    std::vector<double> co_moments;
+  };
+
+  /**
+   * Adds a frame's value to `sums`, where `count` includes this frame and `field_deviations` are how far each
+   * field's value in it is from that field's mean, also including it.
+   */
+  inline void add(Sums &sums, double value, double count, const std::vector<double> &field_deviations)
+  {
+    double delta = value - sums.mean;
+    sums.mean += delta / count;
+    sums.m2 += delta * (value - sums.mean);
+    for (size_t field = 0; field < field_deviations.size(); ++field)
+    {
+      sums.co_moments[field] += delta * field_deviations[field];
+    }
+  }
+
+  /** Everything one thread accumulates over its share of the frames */
+  struct Partial
+  {
+    uint64_t count = 0;
+    std::vector<Sums> bits;
+    std::vector<Sums> bytes;
+    std::vector<double> field_means;
+    /** Sums of squared deviations from each field's mean */
+    std::vector<double> field_m2;
+    std::vector<uint8_t> byte_seen;
+
+    Partial(const Schema &schema)
+        : bits(schema.frame_size * 8), bytes(schema.frame_size), field_means(schema.field_count),
+          field_m2(schema.field_count), byte_seen(schema.frame_size * 32)
+    {
+      for (Sums &sums : bits)
+      {
+        sums.co_moments.resize(schema.field_count);
+      }
+      for (Sums &sums : bytes)
+      {
+        sums.co_moments.resize(schema.field_count);
+      }
+    }
+
+    /** Combines the moments of two sets of frames, which only need each set's means to be shifted into place */
+    void merge(const Partial &other)
+    {
+      if (!other.count)
+      {
+        return;
+      }
+      double total = static_cast<double>(count + other.count);
+      double share = other.count / total;
+      double weight = count * share;
+      std::vector<double> field_deltas(field_means.size());
+      for (size_t idx = 0; idx < field_means.size(); ++idx)
+      {
+        field_deltas[idx] = other.field_means[idx] - field_means[idx];
+        field_means[idx] += field_deltas[idx] * share;
+        field_m2[idx] += other.field_m2[idx] + field_deltas[idx] * field_deltas[idx] * weight;
+      }
+      merge(bits, other.bits, share, weight, field_deltas);
+      merge(bytes, other.bytes, share, weight, field_deltas);
+      for (size_t idx = 0; idx < byte_seen.size(); ++idx)
+      {
+        byte_seen[idx] |= other.byte_seen[idx];
+      }
+      count += other.count;
+    }
+
+    static void merge(std::vector<Sums> &into, const std::vector<Sums> &from, double share, double weight,
+                      const std::vector<double> &field_deltas)
+    {
+      for (size_t idx = 0; idx < into.size(); ++idx)
+      {
+        double delta = from[idx].mean - into[idx].mean;
+        into[idx].changes += from[idx].changes;
+        into[idx].mean += delta * share;
+        into[idx].m2 += from[idx].m2 + delta * delta * weight;
+        for (size_t field = 0; field < field_deltas.size(); ++field)
+        {
+          into[idx].co_moments[field] += from[idx].co_moments[field] + delta * field_deltas[field] * weight;
+        }
+      }
+    }
+  };
+
+  void analyze(const Schema &schema, const std::vector<const uint8_t *> &frames, size_t begin, size_t end,
+               Partial &partial)
+  {
+    std::vector<double> deviations(schema.field_count);
+    for (size_t idx = begin; idx < end; ++idx)
+    {
+      const uint8_t *frame = frames[idx];
+      const uint8_t *previous = idx > 0 ? frames[idx - 1] : nullptr;
+      double count = static_cast<double>(++partial.count);
+      for (size_t field = 0; field < schema.field_count; ++field)
+      {
+        double value = schema.fields[field].value(frame);
+        double delta = value - partial.field_means[field];
+        partial.field_means[field] += delta / count;
+        deviations[field] = value - partial.field_means[field];
+        partial.field_m2[field] += delta * deviations[field];
+      }
+      for (size_t byte = 0; byte < schema.frame_size; ++byte)
+      {
+        uint8_t mask = schema.unknown_mask[byte];
+        if (!mask)
+        {
+          continue;
+        }
+        uint8_t value = frame[byte];
+        if (mask == 0xff)
+        {
+          Sums &sums = partial.bytes[byte];
+          sums.changes += previous && previous[byte] != value;
+          add(sums, value, count, deviations);
+          partial.byte_seen[byte * 32 + value / 8] |= 1 << (value % 8);
+        }
+        for (size_t bit = 0; bit < 8; ++bit)
+        {
+          if (!(mask & (1 << bit)))
+          {
+            continue;
+          }
+          bool set = value & (1 << bit);
+          Sums &sums = partial.bits[byte * 8 + bit];
+          sums.changes += previous && ((previous[byte] ^ value) & (1 << bit));
+          add(sums, set, count, deviations);
+        }
+      }
+    }
+  }
+
+  double correlation(const Partial &total, const Sums &sums, size_t field)
+  {
+    if (sums.m2 <= 0 || total.field_m2[field] <= 0)
+    {
+      return 0;
+    }
+    return sums.co_moments[field] / std::sqrt(sums.m2 * total.field_m2[field]);
+  }
+
+  struct Candidate
+  {
+    std::string location;
+    double mean;
+    double change_rate;
+    size_t distinct;
+    size_t field;
+    double r;
+  };
+
+  Candidate rank(const Schema &schema, const Partial &total, const Sums &sums, const std::string &location,
+                 size_t distinct)
+  {
+    Candidate candidate = {location, sums.mean,
+                           total.count > 1 ? static_cast<double>(sums.changes) / (total.count - 1) : 0, distinct, 0, 0};
+    for (size_t field = 0; field < schema.field_count; ++field)
+    {
+      double r = correlation(total, sums, field);
+      if (std::fabs(r) > std::fabs(candidate.r))
+      {
+        candidate.r = r;
+        candidate.field = field;
+      }
+    }
+    return candidate;
+  }
+
+  /** Extracts frames of the schema's size from a `WireTracer` dump */
+  void frames_from_trace(const Schema &schema, const std::vector<uint8_t> &capture,
+                         std::vector<const uint8_t *> &frames)
+  {
+    TraceDirection wanted = schema.frame_size == RESPONSE_SIZE ? TraceDirection::Received : TraceDirection::Sent;
+    size_t offset = 0;
+    while (offset + TRACE_RECORD_HEADER_SIZE <= capture.size())
+    {
+      size_t length = capture[offset + TRACE_RECORD_HEADER_SIZE - 1];
+      if (offset + TRACE_RECORD_HEADER_SIZE + length > capture.size())
+      {
+        break;
+      }
+      if (capture[offset + 4] == static_cast<uint8_t>(wanted) && length == schema.frame_size)
+      {
+        frames.push_back(capture.data() + offset + TRACE_RECORD_HEADER_SIZE);
+      }
+      offset += TRACE_RECORD_HEADER_SIZE + length;
+    }
+  }
+
+  int usage(const char *program)
+  {
+    fprintf(stderr, "usage: %s [-t response|command] [--trace] [-j threads] [-n top] capture.bin\n", program);
+    return 2;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool commands = false;
+  bool trace = false;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t top = 40;
+  const char *path = nullptr;
+  for (int arg = 1; arg < argc; ++arg)
+  {
+    if (!strcmp(argv[arg], "-t") && arg + 1 < argc)
+    {
+      commands = !strcmp(argv[++arg], "command");
+    }
+    else if (!strcmp(argv[arg], "--trace"))
+    {
+      trace = true;
+    }
+    else if (!strcmp(argv[arg], "-j") && arg + 1 < argc)
+    {
+      threads = std::max(1, atoi(argv[++arg]));
+    }
+    else if (!strcmp(argv[arg], "-n") && arg + 1 < argc)
+    {
+      top = atoi(argv[++arg]);
+    }
+    else if (argv[arg][0] != '-' && !path)
+    {
+      path = argv[arg];
+    }
+    else
+    {
+      return usage(argv[0]);
+    }
+  }
+  if (!path)
+  {
+    return usage(argv[0]);
+  }
+
+  FILE *file = fopen(path, "rb");
+  if (!file)
+  {
+    perror(path);
+    return 1;
+  }
+  std::vector<uint8_t> capture;
+  uint8_t chunk[1 << 16];
+  size_t chunk_length;
+  while ((chunk_length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+  {
+    capture.insert(capture.end(), chunk, chunk + chunk_length);
+  }
+  fclose(file);
+
+  const Schema schema = commands ? command_schema() : response_schema();
+  std::vector<const uint8_t *> frames;
+  if (trace)
+  {
+    frames_from_trace(schema, capture, frames);
+  }
+  else
+  {
+    for (size_t offset = 0; offset + schema.frame_size <= capture.size(); offset += schema.frame_size)
+    {
+      frames.push_back(capture.data() + offset);
+    }
+  }
+  if (frames.size() < 2)
+  {
+    fprintf(stderr, "%s: need at least 2 %s frames, found %zu\n", path, schema.name, frames.size());
+    return 1;
+  }
+
+  threads = std::min(threads, frames.size());
+  std::vector<Partial> partials(threads, Partial(schema));
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < threads; ++worker)
+  {
+    size_t begin = frames.size() * worker / threads;
+    size_t end = frames.size() * (worker + 1) / threads;
+    workers.emplace_back(analyze, std::cref(schema), std::cref(frames), begin, end, std::ref(partials[worker]));
+  }
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+  Partial &total = partials[0];
+  for (size_t worker = 1; worker < threads; ++worker)
+  {
+    total.merge(partials[worker]);
+  }
+
+  std::vector<Candidate> candidates;
+  std::vector<std::string> constant;
+  char location[32];
+  for (size_t byte = 0; byte < schema.frame_size; ++byte)
+  {
+    if (schema.unknown_mask[byte] == 0xff)
+    {
+      size_t distinct = 0;
+      for (size_t idx = 0; idx < 32; ++idx)
+      {
+        distinct += __builtin_popcount(total.byte_seen[byte * 32 + idx]);
+      }
+      snprintf(location, sizeof(location), "byte %02zx", byte);
+      if (distinct > 1)
+      {
+        candidates.push_back(rank(schema, total, total.bytes[byte], location, distinct));
+      }
+    }
+    for (size_t bit = 0; bit < 8; ++bit)
+    {
+      if (!(schema.unknown_mask[byte] & (1 << bit)))
+      {
+        continue;
+      }
+      const Sums &sums = total.bits[byte * 8 + bit];
+      snprintf(location, sizeof(location), "bit %02zx.%zu", byte, bit);
+      if (sums.m2 == 0)
+      {
+        snprintf(location, sizeof(location), "%02zx.%zu=%d", byte, bit, sums.mean != 0);
+        constant.push_back(location);
+        continue;
+      }
+      candidates.push_back(rank(schema, total, sums, location, 2));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) { return std::fabs(a.r) > std::fabs(b.r); });
+
+  printf("%zu %s frames, %zu threads\n\n", frames.size(), schema.name, threads);
+  printf("%-12s %8s %8s %8s  %-28s %7s\n", "location", "mean", "changes", "distinct", "best match", "r");
+  for (size_t idx = 0; idx < candidates.size() && idx < top; ++idx)
+  {
+    const Candidate &candidate = candidates[idx];
+    printf("%-12s %8.3f %8.4f %8zu  %-28s %7.3f\n", candidate.location.c_str(), candidate.mean,
+           candidate.change_rate, candidate.distinct, schema.fields[candidate.field].name, candidate.r);
+  }
+  printf("\n%zu unknown bits never changed:", constant.size());
+  for (size_t idx = 0; idx < constant.size(); ++idx)
+  {
+    printf("%s%s", idx % 12 ? " " : "\n  ", constant[idx].c_str());
+  }
+  printf("\n");
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * `AnomalyDetector`: warm-up, flagging only readings that are both many deviations from the mean and in the tail of
+ * the histogram, separate baselines per mode and frequency band, and ignoring readings while the unit is off.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "anomaly_detector.h"
+#include "host_test.h"
+
+using namespace pioneer_uart;
+using namespace pioneer_uart::response;
+
+namespace
+{
+  WytResponse reading(OpMode mode, uint8_t discharge, uint8_t coil, uint8_t frequency, uint8_t amps, bool power = true)
+  {
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.power = power;
+    state.mode = mode;
+    state.compressor_discharge_temp = discharge;
+    state.condenser_coil_temp = coil;
+    state.compressor_frequency = frequency;
+    state.current_used_amps = amps;
+    return state;
+  }
+
+  /** Feeds `count` steady cooling readings at 40 Hz, with the discharge temperature wobbling by one degree */
+  void train(AnomalyDetector &detector, uint16_t count)
+  {
+    for (uint16_t idx = 0; idx < count; ++idx)
+    {
+      CHECK(detector.observe(reading(OpMode::Cool, static_cast<uint8_t>(69 + idx % 3), 40, 40, 6)) == 0);
+    }
+  }
+
+  void test_flags_outliers()
+  {
+    AnomalyDetector detector;
+    train(detector, 200);
+
+    // Far from the mean, and beyond everything in the histogram
+    CHECK(detector.observe(reading(OpMode::Cool, 95, 40, 40, 6)) == AnomalyDischargeTemperature);
+    CHECK(detector.getLastFlags() == AnomalyDischargeTemperature);
+    CHECK(detector.observe(reading(OpMode::Cool, 70, 40, 40, 14)) == AnomalyCurrentUsedAmps);
+    CHECK(detector.observe(reading(OpMode::Cool, 70, 10, 40, 6)) == AnomalyCondenserCoilTemperature);
+    CHECK(detector.getLastFlags() == AnomalyCondenserCoilTemperature);
+    // Within four deviations of the mean
+    CHECK(detector.observe(reading(OpMode::Cool, 73, 40, 40, 6)) == 0);
+    CHECK(detector.getLastFlags() == 0);
+
+    // Far from the mean, but in the same histogram bucket (64-71) as the usual readings
+    AnomalyDetector steady;
+    for (uint16_t idx = 0; idx < 200; ++idx)
+    {
+      steady.observe(reading(OpMode::Cool, 64, 40, 40, 6));
+    }
+    CHECK(steady.observe(reading(OpMode::Cool, 71, 40, 40, 6)) == 0);
+  }
+
+  void test_warm_up()
+  {
+    AnomalyDetector detector;
+    // Nothing is flagged until a baseline has enough samples
+    train(detector, ANOMALY_WARMUP_SAMPLES - 1);
+    CHECK(detector.observe(reading(OpMode::Cool, 95, 40, 40, 6)) == 0);
+    detector.reset();
+    train(detector, ANOMALY_WARMUP_SAMPLES);
+    CHECK(detector.observe(reading(OpMode::Cool, 95, 40, 40, 6)) == AnomalyDischargeTemperature);
+
+    // Readings while off are ignored, and do not train the baselines
+    detector.reset();
+    for (uint16_t idx = 0; idx < 200; ++idx)
+    {
+      CHECK(detector.observe(reading(OpMode::Cool, 70, 40, 40, 6, false)) == 0);
+    }
+    CHECK(detector.observe(reading(OpMode::Cool, 95, 40, 40, 6)) == 0);
+  }
+
+  void test_baselines()
+  {
+    AnomalyDetector detector;
+    train(detector, 200);
+
+    // Heating has its own baselines, still warming up
+    CHECK(detector.observe(reading(OpMode::Heat, 95, 40, 40, 6)) == 0);
+
+    // The band is picked by the frequency, so the frequency itself is judged against the whole mode and a jump out
+    // of the usual band is flagged, while the other readings start a baseline of their own in the new band
+    CHECK(detector.observe(reading(OpMode::Cool, 95, 40, 100, 6)) == AnomalyCompressorFrequency);
+  }
+
+  void test_callback()
+  {
+    AnomalyDetector detector;
+    train(detector, 200);
+    WytResponse state = reading(OpMode::Cool, 95, 40, 40, 6);
+    AnomalyDetector::onStateUpdate(state, &detector);
+    CHECK(detector.getLastFlags() == AnomalyDischargeTemperature);
+  }
+}
+
+int main()
+{
+  test_flags_outliers();
+  test_warm_up();
+  test_baselines();
+  test_callback();
+  return host_test_result();
+}
@@ -0,0 +1,172 @@
+/*
+ * `CircuitBreaker` against a loopback unit that does not answer: backoff growth and its cap, opening and probing
+ * the circuit, the deadline budget, and a wrapping clock.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "circuit_breaker.h"
+#include "host_test.h"
+
+using namespace pioneer_uart;
+
+namespace
+{
+  const uint32_t BASE_BACKOFF_MS = 1000;
+  const uint32_t MAX_BACKOFF_MS = 8000;
+  const uint32_t TIMEOUT_MS = 1000;
+  const uint32_t PROBE_TIMEOUT_MS = 150;
+
+  CircuitBreaker new_breaker()
+  {
+    return CircuitBreaker(3, TIMEOUT_MS, PROBE_TIMEOUT_MS, BASE_BACKOFF_MS, MAX_BACKOFF_MS);
+  }
+
+  /** Checks that the backoff after a failure at `now_ms` is within the jitter of `backoff_ms` */
+  void check_backoff(const CircuitBreaker &breaker, uint32_t now_ms, uint32_t backoff_ms)
+  {
+    uint32_t waited = breaker.getNextAttemptMs() - now_ms;
+    CHECK(waited >= backoff_ms / 2 && waited <= backoff_ms);
+  }
+
+  void test_backoff()
+  {
+    CircuitBreaker breaker = new_breaker();
+    uint32_t now_ms = 0;
+    // 1 s, doubling with each failure, up to the 8 s cap
+    const uint32_t expected[] = {1000, 2000, 4000, 8000, 8000, 8000};
+    for (size_t idx = 0; idx < sizeof(expected) / sizeof(expected[0]); ++idx)
+    {
+      CHECK(breaker.shouldAttempt(now_ms));
+      breaker.recordFailure(now_ms);
+      check_backoff(breaker, now_ms, expected[idx]);
+      // Not before the backoff is over
+      CHECK(!breaker.shouldAttempt(breaker.getNextAttemptMs() - 1));
+      now_ms = breaker.getNextAttemptMs();
+    }
+    CHECK(breaker.getConsecutiveFailures() == 6);
+
+    // The cap still holds after many more failures than the shift can express
+    for (int idx = 0; idx < 300; ++idx)
+    {
+      CHECK(breaker.shouldAttempt(now_ms));
+      breaker.recordFailure(now_ms);
+      now_ms = breaker.getNextAttemptMs();
+    }
+    CHECK(breaker.getConsecutiveFailures() == 0xff);
+    CHECK(breaker.shouldAttempt(now_ms));
+    breaker.recordFailure(now_ms);
+    check_backoff(breaker, now_ms, MAX_BACKOFF_MS);
+
+    // A success resets the backoff
+    breaker.recordSuccess();
+    CHECK(breaker.shouldAttempt(now_ms));
+    breaker.recordFailure(now_ms);
+    check_backoff(breaker, now_ms, BASE_BACKOFF_MS);
+  }
+
+  void test_circuit()
+  {
+    CircuitBreaker breaker = new_breaker();
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    uint32_t now_ms = 0;
+
+    // Closed until the third consecutive failure, with the normal timeout
+    for (uint8_t failure = 1; failure <= 3; ++failure)
+    {
+      CHECK(breaker.getState() == CircuitState::Closed);
+      CHECK(breaker.poll(unit, now_ms) == AttemptResult::Failed);
+      CHECK(unit.getTransport().getTimeout() == TIMEOUT_MS);
+      CHECK(breaker.poll(unit, now_ms) == AttemptResult::Skipped);
+      now_ms = breaker.getNextAttemptMs();
+    }
+    CHECK(breaker.getState() == CircuitState::Open);
+
+    // Parked until the backoff is over, then probed with the short timeout
+    CHECK(!breaker.shouldAttempt(now_ms - 1));
+    CHECK(breaker.getState() == CircuitState::Open);
+    CHECK(breaker.shouldAttempt(now_ms));
+    CHECK(breaker.getState() == CircuitState::HalfOpen);
+    CHECK(breaker.getTimeout() == PROBE_TIMEOUT_MS);
+
+    // A failed probe opens the circuit again, for longer
+    breaker.recordFailure(now_ms);
+    CHECK(breaker.getState() == CircuitState::Open);
+    check_backoff(breaker, now_ms, 8000);
+    now_ms = breaker.getNextAttemptMs();
+
+    // A probe that succeeds closes it, back to the normal timeout
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(breaker.poll(unit, now_ms) == AttemptResult::Succeeded);
+    CHECK(unit.getTransport().getTimeout() == PROBE_TIMEOUT_MS);
+    CHECK(breaker.getState() == CircuitState::Closed);
+    CHECK(breaker.getConsecutiveFailures() == 0);
+    CHECK(breaker.getTimeout() == TIMEOUT_MS);
+
+    // reset() closes the circuit and forgets the failures, so the next attempt need not wait
+    for (uint8_t failure = 0; failure < 3; ++failure)
+    {
+      breaker.recordFailure(now_ms);
+    }
+    CHECK(breaker.getState() == CircuitState::Open);
+    breaker.reset();
+    CHECK(breaker.getState() == CircuitState::Closed);
+    CHECK(breaker.getConsecutiveFailures() == 0);
+    CHECK(breaker.shouldAttempt(now_ms));
+  }
+
+  void test_budget()
+  {
+    CircuitBreaker breaker = new_breaker();
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+
+    // A poll is 69 bytes on the wire, 72 ms at 9600 baud, and needs 30 ms more to wait for the unit
+    CHECK(CIRCUIT_BREAKER_POLL_TRANSFER_MS == 72);
+    CHECK(breaker.poll(unit, 0, 72 + 29) == AttemptResult::OutOfTime);
+    CHECK(breaker.getConsecutiveFailures() == 0);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(breaker.poll(unit, 0, 72 + 30) == AttemptResult::Succeeded);
+    CHECK(unit.getTransport().getTimeout() == 30);
+
+    // The timeout is what is left of the budget after the transfer, up to the normal one
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(breaker.poll(unit, 0, 500) == AttemptResult::Succeeded);
+    CHECK(unit.getTransport().getTimeout() == 500 - 72);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(breaker.poll(unit, 0, 5000) == AttemptResult::Succeeded);
+    CHECK(unit.getTransport().getTimeout() == TIMEOUT_MS);
+
+#ifndef PIONEER_UART_READ_ONLY
+    // An apply also sends the 35-byte command, 109 ms in all
+    CHECK(CIRCUIT_BREAKER_APPLY_TRANSFER_MS == 109);
+    unit.setPowerOn(false);
+    CHECK(breaker.apply(unit, 0, 109 + 29) == AttemptResult::OutOfTime);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(breaker.apply(unit, 0, 200) == AttemptResult::Succeeded);
+    CHECK(unit.getTransport().getTimeout() == 200 - 109);
+#endif
+  }
+
+  void test_clock_wrap()
+  {
+    CircuitBreaker breaker = new_breaker();
+    uint32_t now_ms = 0xffffff00;
+    breaker.recordFailure(now_ms);
+    uint32_t next_ms = breaker.getNextAttemptMs();
+    // The next attempt is past the wrap
+    CHECK(next_ms < now_ms);
+    CHECK(!breaker.shouldAttempt(now_ms + 1));
+    CHECK(!breaker.shouldAttempt(0xffffffff));
+    CHECK(!breaker.shouldAttempt(next_ms - 1));
+    CHECK(breaker.shouldAttempt(next_ms));
+    CHECK(breaker.shouldAttempt(next_ms + 100000));
+  }
+}
+
+int main()
+{
+  test_backoff();
+  test_circuit();
+  test_budget();
+  test_clock_wrap();
+  return host_test_result();
+}
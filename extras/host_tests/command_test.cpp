@@ -0,0 +1,113 @@
+/*
+ * Encoding of state commands: how the settings in a response carry over into a command built from it, that nothing
+ * else in the response leaks into it, and what the setters put in the pending command.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "pioneer_uart.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  /** Every fan speed, and the command encoding each one should be sent as */
+  const FanSpeed FAN_SPEEDS[] = {FanSpeed::Auto, FanSpeed::Low, FanSpeed::Medium,
+                                 FanSpeed::High, FanSpeed::MidLow, FanSpeed::MidHigh};
+  const command::FanSpeed COMMAND_FAN_SPEEDS[] = {command::FanSpeed::Auto, command::FanSpeed::Low,
+                                                  command::FanSpeed::Medium, command::FanSpeed::High,
+                                                  command::FanSpeed::MidLow, command::FanSpeed::MidHigh};
+  const size_t FAN_SPEED_COUNT = sizeof(FAN_SPEEDS) / sizeof(FAN_SPEEDS[0]);
+
+  WytResponse response_with_fan_speed(FanSpeed speed)
+  {
+    WytResponse response;
+    memset(response.bytes, 0, RESPONSE_SIZE);
+    response.power = true;
+    response.mode = OpMode::Cool;
+    response.fan_speed = speed;
+    return response;
+  }
+
+  void test_fan_speed_from_response()
+  {
+    for (size_t idx = 0; idx < FAN_SPEED_COUNT; ++idx)
+    {
+      CHECK(command::from_response(response_with_fan_speed(FAN_SPEEDS[idx])).fan_speed == COMMAND_FAN_SPEEDS[idx]);
+    }
+  }
+
+  void test_from_response_zeroes_unknown_bytes()
+  {
+    // Every bit set, apart from fields that must hold valid values
+    WytResponse response;
+    memset(response.bytes, 0xff, RESPONSE_SIZE);
+    response.mode = OpMode::Cool;
+    response.fan_speed = FanSpeed::Auto;
+    response.set_temperature_whole = 8;
+    response.sleep = SleepMode::Off;
+    response.up_down_flow = UpDownFlow::Auto;
+    response.left_right_flow = LeftRightFlow::Auto;
+
+    command::WytSetStateCommand command = command::from_response(response);
+    CHECK(command.unknown1[0] == 0 && command.unknown1[1] == 0);
+    CHECK(!command.unknown2 && command.unknown3 == 0 && !command.unknown4 && !command.unknown5);
+    CHECK(command.unknown6 == 0 && command.unknown7 == 0);
+    // Apart from the one byte that is always sent as 0x80
+    CHECK(command.unknown8[0] == 0x80);
+    for (size_t idx = 1; idx < sizeof(command.unknown8); ++idx)
+    {
+      CHECK(command.unknown8[idx] == 0);
+    }
+    for (size_t idx = 0; idx < sizeof(command.unknown9); ++idx)
+    {
+      CHECK(command.unknown9[idx] == 0);
+    }
+    // While the known settings are carried over
+    CHECK(command.power && command.eco && command.display && command.strong && command.health && command.mute);
+    CHECK(!command.beeper);
+    CHECK(command.set_temperature_whole == 24 + 0x6f && command.set_temperature_half);
+    CHECK(command.checksum == command::checksum(command));
+  }
+
+#ifndef PIONEER_UART_READ_ONLY
+  command::WytSetStateCommand pending_command(const PioneerWYTBase &unit)
+  {
+    uint8_t bytes[STATE_COMMAND_SIZE];
+    CHECK(unit.serializePendingState(bytes));
+    return command::from_bytes(bytes);
+  }
+
+  void test_set_fan_speed()
+  {
+    for (size_t idx = 0; idx < FAN_SPEED_COUNT; ++idx)
+    {
+      PioneerWYT unit;
+      unit.deserializeState(response_with_fan_speed(FanSpeed::Auto).bytes);
+      unit.setChosenFanSpeed(FAN_SPEEDS[idx]);
+      CHECK(pending_command(unit).fan_speed == COMMAND_FAN_SPEEDS[idx]);
+    }
+  }
+
+  void test_other_setters_keep_fan_speed()
+  {
+    // A unit running at medium stays at medium when only its temperature is changed
+    PioneerWYT unit;
+    unit.deserializeState(response_with_fan_speed(FanSpeed::Medium).bytes);
+    unit.setChosenTemperature(WYT_DEGREES_C(23));
+    CHECK(pending_command(unit).fan_speed == command::FanSpeed::Medium);
+  }
+#endif
+}
+
+int main()
+{
+  test_fan_speed_from_response();
+  test_from_response_zeroes_unknown_bytes();
+#ifndef PIONEER_UART_READ_ONLY
+  test_set_fan_speed();
+  test_other_setters_keep_fan_speed();
+#endif
+  return host_test_result();
+}
@@ -0,0 +1,150 @@
+/*
+ * `EnergyMeter`: trapezoidal integration, attribution to modes and standby, gaps, a wrapping clock, and the per-day
+ * totals as the day number moves on or is set back.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "energy_meter.h"
+#include "host_test.h"
+
+using namespace pioneer_uart;
+using namespace pioneer_uart::response;
+
+namespace
+{
+  bool total_is(const EnergyTotal &total, uint32_t watt_hours, uint32_t watt_ms = 0)
+  {
+    return total.watt_hours == watt_hours && total.watt_ms == watt_ms;
+  }
+
+  void test_total()
+  {
+    EnergyTotal total = {0, 0};
+    total.add(WATT_MS_PER_WATT_HOUR - 1);
+    CHECK(total_is(total, 0, WATT_MS_PER_WATT_HOUR - 1));
+    total.add(2);
+    CHECK(total_is(total, 1, 1));
+    // More than 32 bits of watt-milliseconds at once
+    total.add(10000ULL * WATT_MS_PER_WATT_HOUR);
+    CHECK(total_is(total, 10001, 1));
+  }
+
+  void test_integration()
+  {
+    EnergyMeter meter;
+    // 230 V x 5 A for an hour, sampled every 10 s
+    for (uint32_t now_ms = 0; now_ms <= 3600000; now_ms += 10000)
+    {
+      meter.addSample(now_ms, 0, 230, 5, OpMode::Cool, true);
+    }
+    CHECK(total_is(meter.getTotal(), 1150));
+    CHECK(total_is(meter.getForMode(OpMode::Cool), 1150));
+    CHECK(total_is(meter.getForDay(0), 1150));
+    CHECK(total_is(meter.getStandby(), 0));
+
+    // A step from 1150 VA to nothing over 2 s counts as the average, 1150 W for 1 s
+    meter.reset();
+    meter.addSample(0, 0, 230, 5, OpMode::Heat, true);
+    meter.addSample(2000, 0, 230, 0, OpMode::Heat, true);
+    CHECK(total_is(meter.getTotal(), 0, 1150 * 1000));
+
+    // Each interval goes to the mode of the sample that starts it, or to standby if the unit was off
+    meter.reset();
+    meter.addSample(0, 0, 200, 2, OpMode::Heat, true);
+    meter.addSample(3600, 0, 200, 2, OpMode::Fan, true);
+    meter.addSample(7200, 0, 200, 2, OpMode::Fan, false);
+    meter.addSample(10800, 0, 200, 2, OpMode::Heat, true);
+    CHECK(total_is(meter.getForMode(OpMode::Heat), 0, 400 * 3600));
+    CHECK(total_is(meter.getForMode(OpMode::Fan), 0, 400 * 3600));
+    CHECK(total_is(meter.getStandby(), 0, 400 * 3600));
+    CHECK(total_is(meter.getTotal(), 1, 3 * 400 * 3600 - WATT_MS_PER_WATT_HOUR));
+  }
+
+  void test_gaps()
+  {
+    EnergyMeter meter(60000);
+    meter.addSample(0, 0, 10, 1, OpMode::Cool, true);
+    meter.addSample(60000, 0, 10, 1, OpMode::Cool, true);
+    // Too long since the last sample: not integrated, but counted
+    meter.addSample(60000 + 60001, 0, 10, 1, OpMode::Cool, true);
+    meter.addSample(60000 + 60001 + 1000, 0, 10, 1, OpMode::Cool, true);
+    CHECK(total_is(meter.getTotal(), 0, 10 * 61000));
+    CHECK(meter.getUnaccountedMs() == 60001);
+
+    // Across a wrap of the clock
+    meter.reset();
+    meter.addSample(0xfffffc18, 0, 10, 1, OpMode::Cool, true);
+    meter.addSample(1000, 0, 10, 1, OpMode::Cool, true);
+    CHECK(total_is(meter.getTotal(), 0, 10 * 2000));
+    CHECK(meter.getUnaccountedMs() == 0);
+  }
+
+  void test_days()
+  {
+    EnergyMeter meter;
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.supply_voltage = 100;
+    state.current_used_amps = 1;
+    // 100 W for 36 s, 1 Wh, on each of days 10 to 12
+    uint32_t now_ms = 0;
+    for (uint16_t day = 10; day <= 12; ++day)
+    {
+      meter.addSample(state, now_ms, day);
+      now_ms += 36000;
+      meter.addSample(state, now_ms, day);
+      now_ms += 1000;
+    }
+    // The step across each midnight, 100 W for 1 s, is credited to the new day
+    CHECK(total_is(meter.getForDay(0), 1, 100 * 1000));
+    CHECK(total_is(meter.getForDay(1), 1, 100 * 1000));
+    CHECK(total_is(meter.getForDay(2), 1));
+    CHECK(total_is(meter.getForDay(3), 0));
+    CHECK(total_is(meter.getForDay(ENERGY_METER_DAYS), 0));
+
+    // Days without samples are cleared as the meter moves past them
+    meter.addSample(state, now_ms, 14);
+    CHECK(total_is(meter.getForDay(0), 0, 100 * 1000));
+    CHECK(total_is(meter.getForDay(1), 0));
+    CHECK(total_is(meter.getForDay(2), 1, 100 * 1000));
+
+    // A week or more later, every day is new
+    meter.addSample(state, now_ms + 1000, 14 + ENERGY_METER_DAYS + 3);
+    for (uint8_t days_ago = 1; days_ago < ENERGY_METER_DAYS; ++days_ago)
+    {
+      CHECK(total_is(meter.getForDay(days_ago), 0));
+    }
+    CHECK(total_is(meter.getTotal(), 3, 4 * 100 * 1000));
+  }
+
+  void test_day_goes_back()
+  {
+    EnergyMeter meter;
+    // 100 W for 36 s on day 20, then on day 21
+    meter.addSample(0, 20, 100, 1, OpMode::Cool, true);
+    meter.addSample(36000, 20, 100, 1, OpMode::Cool, true);
+    meter.addSample(72000, 21, 100, 1, OpMode::Cool, true);
+
+    // The clock is corrected back to day 20: what day 21 had is kept, and more is added to it
+    meter.addSample(108000, 20, 100, 1, OpMode::Cool, true);
+    CHECK(total_is(meter.getForDay(0), 2));
+    CHECK(total_is(meter.getForDay(1), 1));
+    CHECK(total_is(meter.getTotal(), 3));
+
+    // And the days move on from the corrected one
+    meter.addSample(144000, 21, 100, 1, OpMode::Cool, true);
+    CHECK(total_is(meter.getForDay(0), 1));
+    CHECK(total_is(meter.getForDay(1), 2));
+    CHECK(total_is(meter.getForDay(2), 1));
+    CHECK(total_is(meter.getTotal(), 4));
+  }
+}
+
+int main()
+{
+  test_total();
+  test_integration();
+  test_gaps();
+  test_days();
+  test_day_goes_back();
+  return host_test_result();
+}
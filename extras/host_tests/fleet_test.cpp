@@ -0,0 +1,144 @@
+/*
+ * `FleetStore`: that each getter reads back what `update()` stored, the flag queries, and that the indoor
+ * temperature queries, which compare raw readings against an inverted threshold, agree with decoding every unit's
+ * reading.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "wyt_fleet.h"
+#include "host_test.h"
+
+using namespace pioneer_uart;
+using namespace pioneer_uart::response;
+
+namespace
+{
+  void test_getters()
+  {
+    FleetStore<4> fleet;
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.eco = true;
+    state.fan_speed = FanSpeed::MidHigh;
+    state.sleep = SleepMode::Child;
+    state.up_down_flow = UpDownFlow::DownFlow;
+    state.left_right_flow = LeftRightFlow::RightFlow;
+    state.compressor_frequency = 58;
+    fleet.update(2, state);
+
+    CHECK(!fleet.isValid(0));
+    CHECK(fleet.isValid(2));
+    uint16_t flags = fleet.getFlags(2);
+    CHECK((flags & FleetValid) && (flags & FleetPower) && (flags & FleetEco));
+    CHECK(!(flags & FleetDisplay) == !state.display);
+    CHECK(!(flags & FleetStrong) == !state.strong);
+    CHECK(!(flags & FleetHealth) == !state.health);
+    CHECK(!(flags & FleetMute) == !state.mute);
+    CHECK(!(flags & FleetVerticalFlow) == !state.vertical_flow);
+    CHECK(!(flags & FleetHorizontalFlow) == !state.horizontal_flow);
+    CHECK(!(flags & FleetFourWayValve) == !state.four_way_valve_on);
+    CHECK(!(flags & FleetAntifreeze) == !state.antifreeze);
+    CHECK(!(flags & FleetHeatMode) == !state.heat_mode);
+    CHECK(fleet.getMode(2) == OpMode::Heat);
+    CHECK(fleet.getChosenFanSpeed(2) == FanSpeed::MidHigh);
+    CHECK(fleet.getSleepMode(2) == SleepMode::Child);
+    CHECK(fleet.getChosenTemperature(2) == 24.0f);
+    CHECK(fleet.getIndoorTemperature(2) == indoor_sensor_degrees_c(state.indoor_temp_base));
+    CHECK(fleet.getIndoorHeatExchangerTemperature(2) == indoor_sensor_degrees_c(state.indoor_heat_exchanger_temp));
+    CHECK(fleet.getOutdoorTemperature(2) == state.outdoor_temp);
+    CHECK(fleet.getCondenserCoilTemperature(2) == state.condenser_coil_temp);
+    CHECK(fleet.getCompressorDischargeTemperature(2) == state.compressor_discharge_temp);
+    CHECK(fleet.getCompressorFrequency(2) == 58);
+    CHECK(fleet.getIndoorFanSpeed(2) == state.indoor_fan_speed);
+    CHECK(fleet.getOutdoorFanSpeed(2) == state.outdoor_fan_speed);
+    CHECK(fleet.getSupplyVoltage(2) == state.supply_voltage);
+    CHECK(fleet.getCurrentUsedAmps(2) == state.current_used_amps);
+    CHECK(fleet.getUpDownFlow(2) == UpDownFlow::DownFlow);
+    CHECK(fleet.getLeftRightFlow(2) == LeftRightFlow::RightFlow);
+
+    // A half degree setting
+    state.set_temperature_whole = 6;
+    state.set_temperature_half = true;
+    fleet.update(3, state);
+    CHECK(fleet.getChosenTemperature(3) == 22.5f);
+
+    // Out of range updates are ignored
+    fleet.update(4, state);
+    fleet.invalidate(4);
+
+    fleet.invalidate(2);
+    CHECK(!fleet.isValid(2));
+    fleet.clear();
+    CHECK(!fleet.isValid(3));
+  }
+
+  void test_flag_queries()
+  {
+    FleetStore<8> fleet;
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    for (uint16_t unit = 0; unit < 6; ++unit)
+    {
+      state.power = unit % 2 == 0;
+      state.compressor_frequency = static_cast<uint8_t>(unit * 10);
+      fleet.update(unit, state);
+    }
+
+    uint16_t found[8];
+    // Units known to be off, and every valid unit
+    CHECK(fleet.findByFlags(FleetValid | FleetPower, FleetValid, found, 8) == 3);
+    CHECK(found[0] == 1 && found[1] == 3 && found[2] == 5);
+    CHECK(fleet.countByFlags(FleetValid, FleetValid) == 6);
+    CHECK(fleet.countByFlags(FleetValid, 0) == 2);
+    // Results stop at `max_results`, lowest indexes first
+    CHECK(fleet.findByFlags(FleetValid, FleetValid, found, 2) == 2);
+    CHECK(found[0] == 0 && found[1] == 1);
+
+    CHECK(fleet.findCompressorAtOrAbove(30, found, 8) == 3);
+    CHECK(found[0] == 3 && found[2] == 5);
+    // Invalid units are not matched, though their columns still hold a frequency of 0
+    CHECK(fleet.findCompressorAtOrAbove(0, found, 8) == 6);
+  }
+
+  void test_indoor_queries()
+  {
+    // One unit for each raw reading, all on in cool mode
+    FleetStore<256> fleet;
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.mode = OpMode::Cool;
+    for (uint16_t raw = 0; raw < 256; ++raw)
+    {
+      state.indoor_temp_base = static_cast<uint8_t>(raw);
+      fleet.update(raw, state);
+    }
+
+    static uint16_t found[256];
+    // Every tenth of a degree across and past the sensor's range
+    for (int16_t tenths = -200; tenths <= 800; ++tenths)
+    {
+      float threshold = tenths / 10.0f;
+      size_t expected_above = 0;
+      for (uint16_t raw = 0; raw < 256; ++raw)
+      {
+        expected_above += indoor_sensor_decidegrees_c(static_cast<uint8_t>(raw)) >= tenths;
+      }
+      size_t above = fleet.findIndoorAtOrAbove(OpMode::Cool, threshold, found, 256);
+      CHECK(above == expected_above);
+      // Readings only grow with the raw value, so the matches are the top ones
+      CHECK(above == 0 || found[0] == 256 - expected_above);
+      CHECK(fleet.findIndoorBelow(OpMode::Cool, threshold, found, 256) == 256 - expected_above);
+    }
+
+    // Other modes, and units that are off, are not matched
+    CHECK(fleet.findIndoorAtOrAbove(OpMode::Heat, -100.0f, found, 256) == 0);
+    state.power = false;
+    fleet.update(255, state);
+    CHECK(fleet.findIndoorAtOrAbove(OpMode::Cool, -100.0f, found, 256) == 255);
+  }
+}
+
+int main()
+{
+  test_getters();
+  test_flag_queries();
+  test_indoor_queries();
+  return host_test_result();
+}
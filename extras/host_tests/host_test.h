@@ -0,0 +1,44 @@
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "wyt_response.h"
+
+/** Number of failed checks so far */
+static int host_test_failures = 0;
+
+/** Reports a failed condition and carries on, so one run shows every failure */
+#define CHECK(condition)                                                              \
+  do                                                                                  \
+  {                                                                                   \
+    if (!(condition))                                                                 \
+    {                                                                                 \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      ++host_test_failures;                                                           \
+    }                                                                                 \
+  } while (0)
+
+/**
+ * A state response, written for the tests, from a unit heating to 24 °C with a low fan, powered on, with the length
+ * byte and checksum a unit sends
+ */
+static const uint8_t SAMPLE_STATE[RESPONSE_SIZE] = {
+    0xbb, 0x01, 0x00, 0x04, 0x37, 0x00, 0x00, 0x14, 0x18, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x6b, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7d, 0x00,
+    0x00, 0x00, 0x55, 0x0c, 0x14, 0x32, 0x2a, 0x28, 0x4a, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x04, 0x00,
+    0x00, 0x00, 0x00, 0x08, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xd5};
+
+/** Recomputes the checksum of a response whose fields a test has changed, so it is still accepted */
+static inline void set_response_checksum(pioneer_uart::response::WytResponse &response)
+{
+  response.bytes[RESPONSE_SIZE - 1] = pioneer_uart::response::checksum(response);
+}
+
+/** Returns the exit status for `main()`: 0 if every check passed */
+static inline int host_test_result()
+{
+  return host_test_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Round trip of a poll and an apply through `BasicPioneerWYT<LoopbackTransport>`, using a frame framed and
+ * checksummed as a unit sends it, so changes to framing, validation or command encoding are caught on the host.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "pioneer_uart.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  const uint8_t QUERY[QUERY_COMMAND_SIZE] = {0xbb, 0x00, 0x01, 0x04, 0x02, 0x01, 0x00, 0xbd};
+
+  void test_poll()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    CHECK(unit.hasState());
+    CHECK(unit.getTransport().sentLength() == QUERY_COMMAND_SIZE);
+    CHECK(memcmp(unit.getTransport().sent(), QUERY, QUERY_COMMAND_SIZE) == 0);
+    CHECK(unit.isPowerOn());
+    CHECK(unit.getMode() == OpMode::Heat);
+    CHECK(unit.getChosenFanSpeed() == FanSpeed::Low);
+    CHECK(unit.getChosenTemperature() == WYT_DEGREES_C(24));
+    CHECK(unit.getIndoorTemperature() >= WYT_DEGREES_C(20.55) && unit.getIndoorTemperature() <= WYT_DEGREES_C(20.65));
+  }
+
+  void test_poll_rejects_bad_frames()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    // Too short
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE - 1);
+    CHECK(!unit.pollState());
+#ifndef PIONEER_UART_NO_VALIDATION
+    // Source bytes of a controller, as in a query echoed back
+    uint8_t echoed[RESPONSE_SIZE];
+    memcpy(echoed, SAMPLE_STATE, RESPONSE_SIZE);
+    echoed[1] = 0x00;
+    echoed[2] = 0x01;
+    unit.getTransport().queueReceived(echoed, RESPONSE_SIZE);
+    CHECK(!unit.pollState());
+
+    // A length byte counting the checksum, with the checksum fixed up to match
+    WytResponse long_length = from_bytes(SAMPLE_STATE);
+    long_length.command_length = RESPONSE_SIZE - 5;
+    set_response_checksum(long_length);
+    unit.getTransport().queueReceived(long_length.bytes, RESPONSE_SIZE);
+    CHECK(!unit.pollState());
+
+    // One bit flipped in transit
+    WytResponse corrupted = from_bytes(SAMPLE_STATE);
+    corrupted.indoor_temp_base ^= 0x01;
+    unit.getTransport().queueReceived(corrupted.bytes, RESPONSE_SIZE);
+    CHECK(!unit.pollState());
+    CHECK(!unit.hasState());
+#endif
+  }
+
+  void test_sample_is_valid()
+  {
+    WytResponse sample = from_bytes(SAMPLE_STATE);
+    CHECK(sample.command_length == 0x37);
+    CHECK(checksum(sample) == SAMPLE_STATE[RESPONSE_SIZE - 1]);
+    CHECK(is_valid(sample));
+  }
+
+#ifndef PIONEER_UART_READ_ONLY
+  void test_apply()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+
+    unit.setMode(OpMode::Cool);
+    unit.setChosenTemperature(WYT_DEGREES_C(22.5));
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.applySettings());
+
+    // The state command, then the query for the new state
+    const uint8_t *sent = unit.getTransport().sent();
+    CHECK(unit.getTransport().sentLength() == STATE_COMMAND_SIZE + QUERY_COMMAND_SIZE);
+    CHECK(memcmp(sent + STATE_COMMAND_SIZE, QUERY, QUERY_COMMAND_SIZE) == 0);
+    command::WytSetStateCommand command = command::from_bytes(sent);
+    CHECK(command.header.magic == 0xbb);
+    CHECK(command.checksum == command::checksum(command));
+    CHECK(command.power);
+    CHECK(command.mode == command::OpMode::Cool);
+    CHECK(command.fan_speed == command::FanSpeed::Low);
+    CHECK(command.set_temperature_whole == 22 + 0x6f);
+    CHECK(command.set_temperature_half);
+    // Bytes with no known meaning are sent as zero
+    for (size_t idx = 0; idx < sizeof(command.unknown9); ++idx)
+    {
+      CHECK(command.unknown9[idx] == 0);
+    }
+
+    // Nothing is pending after applying
+    unit.getTransport().clearSent();
+    CHECK(!unit.applySettings());
+    CHECK(unit.getTransport().sentLength() == 0);
+  }
+#endif
+}
+
+int main()
+{
+  test_sample_is_valid();
+  test_poll();
+  test_poll_rejects_bad_frames();
+#ifndef PIONEER_UART_READ_ONLY
+  test_apply();
+#endif
+  return host_test_result();
+}
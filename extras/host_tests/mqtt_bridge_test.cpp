@@ -0,0 +1,231 @@
+/*
+ * `MqttBridge` against a fake client: what is published and when, how commands are debounced into a single state
+ * command and retried when it fails, and the Home Assistant discovery config.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "mqtt_bridge.h"
+#include "host_test.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  struct Message
+  {
+    std::string topic;
+    std::string payload;
+    bool retain;
+  };
+
+  /** Records what the bridge publishes and subscribes to, and can be made to fail */
+  class FakeMqttClient : public MqttClient
+  {
+  public:
+    std::vector<Message> published;
+    std::vector<std::string> subscribed;
+    bool fail = false;
+
+    bool publish(const char *topic, const char *payload, size_t length, bool retain) override
+    {
+      if (fail)
+      {
+        return false;
+      }
+      published.push_back(Message{topic, std::string(payload, length), retain});
+      return true;
+    }
+    bool subscribe(const char *topic_filter) override
+    {
+      subscribed.push_back(topic_filter);
+      return !fail;
+    }
+  };
+
+  bool contains(const std::string &text, const char *part)
+  {
+    return text.find(part) != std::string::npos;
+  }
+
+  void test_publish()
+  {
+    FakeMqttClient client;
+    MqttBridge bridge(client, "pioneer/test", 500, 60000);
+    WytResponse state = from_bytes(SAMPLE_STATE);
+
+    CHECK(bridge.begin());
+    // The first publish is full and retained
+    CHECK(bridge.publishState(state, 0));
+    CHECK(client.published.size() == 1);
+    CHECK(client.published[0].topic == "pioneer/test/state");
+    CHECK(client.published[0].retain);
+    CHECK(contains(client.published[0].payload, "\"power\":true"));
+    CHECK(contains(client.published[0].payload, "\"chosen_temperature\":24"));
+
+    // Nothing changed, so nothing is sent
+    CHECK(bridge.publishState(state, 1000));
+    CHECK(client.published.size() == 1);
+
+    // Only the changed field is sent, not retained
+    state.indoor_temp_base += 1;
+    CHECK(bridge.publishState(state, 2000));
+    CHECK(client.published.size() == 2);
+    CHECK(!client.published[1].retain);
+    CHECK(contains(client.published[1].payload, "\"indoor_temperature\""));
+    CHECK(!contains(client.published[1].payload, "\"power\""));
+
+    // A failed publish is retried with the next one
+    client.fail = true;
+    state.indoor_temp_base += 1;
+    CHECK(!bridge.publishState(state, 3000));
+    client.fail = false;
+    CHECK(bridge.publishState(state, 4000));
+    CHECK(client.published.size() == 3);
+    CHECK(contains(client.published[2].payload, "\"indoor_temperature\""));
+
+    // Power changes are published in full
+    state.power = false;
+    CHECK(bridge.publishState(state, 5000));
+    CHECK(client.published.size() == 4);
+    CHECK(client.published[3].retain);
+    CHECK(contains(client.published[3].payload, "\"mode\""));
+
+    // And so is the periodic full state
+    CHECK(bridge.publishState(state, 65000));
+    CHECK(client.published.size() == 5);
+    CHECK(client.published[4].retain);
+  }
+
+#ifndef PIONEER_UART_READ_ONLY
+  bool message(MqttBridge &bridge, const char *topic, const char *payload, uint32_t now_ms)
+  {
+    return bridge.handleMessage(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), now_ms);
+  }
+
+  void test_commands()
+  {
+    FakeMqttClient client;
+    MqttBridge bridge(client, "pioneer/test", 500, 60000);
+    CHECK(bridge.begin());
+    CHECK(client.subscribed.size() == 1 && client.subscribed[0] == "pioneer/test/set/+");
+
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+
+    // Other topics are not for this bridge; invalid values are, but are dropped
+    CHECK(!message(bridge, "pioneer/other/set/mode", "cool", 0));
+    CHECK(message(bridge, "pioneer/test/set/chosen_temperature", "12", 0));
+    CHECK(message(bridge, "pioneer/test/set/chosen_fan_speed", "fastest", 0));
+    CHECK(!bridge.hasPendingCommands());
+
+    CHECK(message(bridge, "pioneer/test/set/mode", "cool", 1000));
+    CHECK(message(bridge, "pioneer/test/set/chosen_temperature", "22", 1100));
+    CHECK(message(bridge, "pioneer/test/set/chosen_temperature", "22.5", 1200));
+    CHECK(message(bridge, "pioneer/test/set/chosen_fan_speed", "medium", 1300));
+    CHECK(bridge.hasPendingCommands());
+
+    // Still settling, so nothing is sent
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(bridge.loop(unit, 1700));
+    CHECK(unit.getTransport().sentLength() == 0);
+
+    // Settled: one state command with every change, then the query for the new state
+    CHECK(bridge.loop(unit, 1800));
+    CHECK(!bridge.hasPendingCommands());
+    CHECK(unit.getTransport().sentLength() == STATE_COMMAND_SIZE + QUERY_COMMAND_SIZE);
+    command::WytSetStateCommand command = command::from_bytes(unit.getTransport().sent());
+    CHECK(command.power);
+    CHECK(command.mode == command::OpMode::Cool);
+    CHECK(command.set_temperature_whole == 22 + 0x6f);
+    CHECK(command.set_temperature_half);
+    CHECK(command.fan_speed == command::FanSpeed::Medium);
+
+    // Home Assistant's `off` turns the unit off without touching the mode
+    unit.getTransport().clearSent();
+    CHECK(message(bridge, "pioneer/test/set/mode", "off", 2000));
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(bridge.loop(unit, 2500));
+    command = command::from_bytes(unit.getTransport().sent());
+    CHECK(!command.power);
+    CHECK(command.mode == command::OpMode::Heat);
+  }
+
+  void test_retries_failed_commands()
+  {
+    FakeMqttClient client;
+    MqttBridge bridge(client, "pioneer/test", 500, 60000);
+    CHECK(bridge.begin());
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+
+    // The unit does not answer, so the command is kept
+    CHECK(message(bridge, "pioneer/test/set/chosen_temperature", "21", 0));
+    CHECK(!bridge.loop(unit, 500));
+    CHECK(bridge.hasPendingCommands());
+    CHECK(unit.getTransport().sentLength() == STATE_COMMAND_SIZE + QUERY_COMMAND_SIZE);
+
+    // And sent again on the next loop
+    unit.getTransport().clearSent();
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(bridge.loop(unit, 600));
+    CHECK(!bridge.hasPendingCommands());
+    CHECK(command::from_bytes(unit.getTransport().sent()).set_temperature_whole == 21 + 0x6f);
+
+    // A command the unit already matches by the retry is dropped without sending anything
+    CHECK(message(bridge, "pioneer/test/set/mode", "cool", 700));
+    unit.getTransport().clearSent();
+    CHECK(!bridge.loop(unit, 1200));
+    CHECK(bridge.hasPendingCommands());
+    WytResponse cooling = from_bytes(SAMPLE_STATE);
+    cooling.mode = OpMode::Cool;
+    set_response_checksum(cooling);
+    unit.getTransport().queueReceived(cooling.bytes, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+    CHECK(bridge.loop(unit, 1300));
+    CHECK(!bridge.hasPendingCommands());
+    CHECK(unit.getTransport().sentLength() == 0);
+  }
+#endif
+
+  void test_discovery()
+  {
+    FakeMqttClient client;
+    MqttBridge bridge(client, "pioneer/test");
+    char config[MQTT_BRIDGE_BUFFER_SIZE];
+
+    size_t length = bridge.discoveryConfig(config, sizeof(config), "living_room-1", "Living \"room\" \\ 1");
+    CHECK(length > 0 && length == strlen(config));
+    CHECK(contains(config, "\"name\":\"Living \\\"room\\\" \\\\ 1\""));
+    CHECK(contains(config, "\"min_temp\":16,\"max_temp\":30"));
+    CHECK(contains(config, "\"fan_modes\":[\"auto\",\"low\",\"medium\","));
+
+    CHECK(bridge.discoveryConfig(config, sizeof(config), "living room", "Living room") == 0);
+    CHECK(bridge.discoveryConfig(config, sizeof(config), "", "Living room") == 0);
+    CHECK(bridge.discoveryConfig(config, 100, "living_room", "Living room") == 0);
+
+    CHECK(bridge.publishDiscovery("living_room", "Living room"));
+    CHECK(client.published.size() == 1);
+    CHECK(client.published[0].topic == "homeassistant/climate/living_room/config");
+    CHECK(client.published[0].retain);
+    CHECK(!bridge.publishDiscovery("living/room", "Living room"));
+  }
+}
+
+int main()
+{
+  test_publish();
+#ifndef PIONEER_UART_READ_ONLY
+  test_commands();
+  test_retries_failed_commands();
+#endif
+  test_discovery();
+  return host_test_result();
+}
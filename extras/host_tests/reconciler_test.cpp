@@ -0,0 +1,153 @@
+/*
+ * `Reconciler` against a loopback unit: waiting for a polled state, staging only the settings that drifted, rate
+ * limiting, respecting manual changes, and sending with `reconcile()`.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "reconciler.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+#ifndef PIONEER_UART_READ_ONLY
+namespace
+{
+  /** Keeps one record in memory */
+  class MemoryStateStore : public StateStore
+  {
+  public:
+    uint8_t record[STATE_RECORD_SIZE];
+    bool has_record = false;
+
+  protected:
+    bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      memcpy(bytes, record, STATE_RECORD_SIZE);
+      return has_record;
+    }
+    bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      memcpy(record, bytes, STATE_RECORD_SIZE);
+      has_record = true;
+      return true;
+    }
+  };
+
+  /** Makes `unit` poll a copy of the sample state, which is on in heat mode at 24 °C, with the given mode */
+  void poll(BasicPioneerWYT<LoopbackTransport> &unit, OpMode mode)
+  {
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.mode = mode;
+    set_response_checksum(state);
+    unit.getTransport().queueReceived(state.bytes, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+  }
+
+  command::WytSetStateCommand pending_command(const PioneerWYTBase &unit)
+  {
+    uint8_t bytes[STATE_COMMAND_SIZE];
+    CHECK(unit.serializePendingState(bytes));
+    return command::from_bytes(bytes);
+  }
+
+  DesiredState cool_at(DegreesC temperature)
+  {
+    DesiredState desired;
+    desired.setMode(OpMode::Cool);
+    desired.setChosenTemperature(temperature);
+    return desired;
+  }
+
+  void test_needs_polled_state()
+  {
+    Reconciler reconciler;
+    reconciler.setDesired(cool_at(WYT_DEGREES_C(24)));
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    CHECK(reconciler.stage(unit, 0) == ReconcileResult::NoState);
+
+    // A restored state may be out of date, so nothing is staged on it
+    MemoryStateStore store;
+    CHECK(store.save(from_bytes(SAMPLE_STATE)));
+    BasicPioneerWYT<LoopbackTransport> restored(LoopbackTransport(), store);
+    CHECK(restored.isStateRestored());
+    CHECK(reconciler.stage(restored, 0) == ReconcileResult::NoState);
+    uint8_t bytes[STATE_COMMAND_SIZE];
+    CHECK(!restored.serializePendingState(bytes));
+    CHECK(reconciler.reconcile(restored, 0) == ReconcileResult::NoState);
+    CHECK(restored.getTransport().sentLength() == 0);
+
+    // Until it is polled
+    poll(restored, OpMode::Heat);
+    CHECK(reconciler.stage(restored, 0) == ReconcileResult::Staged);
+    CHECK(pending_command(restored).mode == command::OpMode::Cool);
+  }
+
+  void test_stages_differences()
+  {
+    Reconciler reconciler(OverridePolicy::Enforce, 1000);
+    reconciler.setDesired(cool_at(WYT_DEGREES_C(24)));
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    poll(unit, OpMode::Cool);
+    CHECK(reconciler.stage(unit, 0) == ReconcileResult::InSync);
+    uint8_t bytes[STATE_COMMAND_SIZE];
+    CHECK(!unit.serializePendingState(bytes));
+
+    // Only the setting that drifted is changed
+    reconciler.setDesired(cool_at(WYT_DEGREES_C(22)));
+    CHECK(reconciler.stage(unit, 0) == ReconcileResult::Staged);
+    command::WytSetStateCommand command = pending_command(unit);
+    CHECK(command.mode == command::OpMode::Cool);
+    CHECK(command.set_temperature_whole == 22 + 0x6f);
+
+    // Not again until the interval is over
+    CHECK(reconciler.stage(unit, 999) == ReconcileResult::RateLimited);
+    CHECK(reconciler.stage(unit, 1000) == ReconcileResult::Staged);
+  }
+
+  void test_respects_manual_changes()
+  {
+    Reconciler reconciler(OverridePolicy::RespectManual, 0, 5000);
+    reconciler.setDesired(cool_at(WYT_DEGREES_C(24)));
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    poll(unit, OpMode::Cool);
+    CHECK(reconciler.stage(unit, 0) == ReconcileResult::InSync);
+
+    // Someone switches to heat with the remote
+    poll(unit, OpMode::Heat);
+    CHECK(reconciler.stage(unit, 100) == ReconcileResult::Overridden);
+    CHECK(reconciler.isOverridden(5099));
+    CHECK(reconciler.stage(unit, 5099) == ReconcileResult::Overridden);
+    CHECK(reconciler.stage(unit, 5100) == ReconcileResult::Staged);
+  }
+
+  void test_reconcile()
+  {
+    Reconciler reconciler;
+    reconciler.setDesired(cool_at(WYT_DEGREES_C(24)));
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    poll(unit, OpMode::Heat);
+
+    // No answer to the command
+    CHECK(reconciler.reconcile(unit, 0) == ReconcileResult::Failed);
+    CHECK(unit.getTransport().sentLength() >= STATE_COMMAND_SIZE);
+
+    unit.getTransport().clearSent();
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(reconciler.reconcile(unit, RECONCILER_DEFAULT_MIN_INTERVAL_MS) == ReconcileResult::Applied);
+    CHECK(command::from_bytes(unit.getTransport().sent()).mode == command::OpMode::Cool);
+  }
+}
+#endif
+
+int main()
+{
+#ifndef PIONEER_UART_READ_ONLY
+  test_needs_polled_state();
+  test_stages_differences();
+  test_respects_manual_changes();
+  test_reconcile();
+#endif
+  return host_test_result();
+}
@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# Builds each `*_test.cpp` here against the library with the host compiler, in the default configuration and in
+# each option of `pioneer_uart_config.h` that changes behavior or adds hooks, and runs it. Fails if any test fails.
+#
+# Usage:
+#   run_tests.sh
+#
+# Environment:
+#   CXX        host compiler (default g++)
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT="$HERE/../.."
+CXX=${CXX:-g++}
+CXXFLAGS="-std=gnu++11 -O1 -g -Wall -Wextra"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# name:flags, with flags comma separated
+CONFIGS="default:
+read_only:-DPIONEER_UART_READ_ONLY
+fixed_point:-DPIONEER_UART_FIXED_POINT
+no_validation:-DPIONEER_UART_NO_VALIDATION
+trace:-DPIONEER_UART_TRACE"
+
+failed=0
+for test in "$HERE"/*_test.cpp; do
+  name=$(basename "$test" .cpp)
+  for config in $CONFIGS; do
+    config_name=${config%%:*}
+    flags=$(echo "${config#*:}" | tr ',' ' ')
+    if "$CXX" $CXXFLAGS $flags -I"$ROOT/include" "$test" "$ROOT"/src/*.cpp -o "$WORK/$name" -lpthread 2> "$WORK/log" &&
+      "$WORK/$name"; then
+      echo "PASS $name $config_name"
+    else
+      cat "$WORK/log"
+      echo "FAIL $name $config_name"
+      failed=1
+    fi
+  done
+done
+exit $failed
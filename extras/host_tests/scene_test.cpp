@@ -0,0 +1,139 @@
+/*
+ * `command::Scene`: that a scene built at compile time is byte for byte the command the setters build on a unit in
+ * the scene's default state, checksum included, and how temperatures are rounded and clamped.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "pioneer_uart.h"
+#include "wyt_scene.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  // Frames are constant expressions, as they must be to go in flash
+  constexpr command::SceneFrame ALL_OFF = command::Scene().power(false).frame();
+  constexpr command::SceneFrame COOL_24 =
+      command::Scene().power(true).mode(command::OpMode::Cool).temperature(24).frame();
+  constexpr command::SceneFrame HEAT_21_5 = command::Scene()
+                                                .power(true)
+                                                .mode(command::OpMode::Heat)
+                                                .temperature(21.5f)
+                                                .fanSpeed(command::FanSpeed::MidLow)
+                                                .frame();
+
+  bool frames_equal(const command::SceneFrame &lhs, const command::SceneFrame &rhs)
+  {
+    return memcmp(lhs.bytes, rhs.bytes, STATE_COMMAND_SIZE) == 0;
+  }
+
+  void test_checksum()
+  {
+    const command::SceneFrame frames[] = {ALL_OFF, COOL_24, HEAT_21_5};
+    for (size_t idx = 0; idx < sizeof(frames) / sizeof(frames[0]); ++idx)
+    {
+      command::WytSetStateCommand command = command::from_bytes(frames[idx].bytes);
+      CHECK(frames[idx].bytes[STATE_COMMAND_SIZE - 1] == command::checksum(command));
+    }
+  }
+
+  void test_temperature()
+  {
+    // Rounded down to the half degree
+    CHECK(frames_equal(command::Scene().temperature(21.7f).frame(), command::Scene().temperature(21.5f).frame()));
+    CHECK(HEAT_21_5.bytes[0x0b] == 0x20);
+    CHECK(COOL_24.bytes[0x0b] == 0);
+    // Clamped to 10-30 °C
+    CHECK(frames_equal(command::Scene().temperature(35).frame(), command::Scene().temperature(30).frame()));
+    CHECK(frames_equal(command::Scene().temperature(-5).frame(), command::Scene().temperature(10).frame()));
+    CHECK(!frames_equal(command::Scene().temperature(10).frame(), command::Scene().temperature(10.5f).frame()));
+  }
+
+#ifndef PIONEER_UART_READ_ONLY
+  /** Seeds `unit` with a state matching the settings `Scene()` starts from: off, auto, 24 °C and display on */
+  void seed_scene_defaults(PioneerWYTBase &unit)
+  {
+    WytResponse state;
+    memset(state.bytes, 0, RESPONSE_SIZE);
+    state.mode = OpMode::Auto;
+    state.fan_speed = FanSpeed::Auto;
+    state.display = true;
+    unit.deserializeState(state.bytes);
+    unit.setChosenTemperature(WYT_DEGREES_C(24));
+  }
+
+  void check_matches(const PioneerWYTBase &unit, const command::SceneFrame &frame)
+  {
+    command::SceneFrame pending;
+    CHECK(unit.serializePendingState(pending.bytes));
+    CHECK(frames_equal(pending, frame));
+  }
+
+  void test_matches_setters()
+  {
+    PioneerWYT all_off;
+    seed_scene_defaults(all_off);
+    all_off.setPowerOn(false);
+    check_matches(all_off, ALL_OFF);
+
+    PioneerWYT cool;
+    seed_scene_defaults(cool);
+    cool.setPowerOn(true);
+    cool.setMode(OpMode::Cool);
+    check_matches(cool, COOL_24);
+
+    PioneerWYT heat;
+    seed_scene_defaults(heat);
+    heat.setPowerOn(true);
+    heat.setMode(OpMode::Heat);
+    heat.setChosenTemperature(WYT_DEGREES_C(21.5));
+    heat.setChosenFanSpeed(FanSpeed::MidLow);
+    check_matches(heat, HEAT_21_5);
+
+#ifndef PIONEER_UART_BASIC_SETTERS
+    // Every other setting, away from its default
+    constexpr command::SceneFrame EVERYTHING = command::Scene()
+                                                  .power(true)
+                                                  .mode(command::OpMode::Dehumidify)
+                                                  .temperature(18)
+                                                  .fanSpeed(command::FanSpeed::High)
+                                                  .sleep(command::SleepMode::Child)
+                                                  .eco(true)
+                                                  .strong(true)
+                                                  .display(false)
+                                                  .health(true)
+                                                  .mute(true)
+                                                  .upDownFlow(command::UpDownFlow::DownFlow)
+                                                  .leftRightFlow(command::LeftRightFlow::RightFlow)
+                                                  .frame();
+    PioneerWYT everything;
+    seed_scene_defaults(everything);
+    everything.setPowerOn(true);
+    everything.setMode(OpMode::Dehumidify);
+    everything.setChosenTemperature(WYT_DEGREES_C(18));
+    everything.setChosenFanSpeed(FanSpeed::High);
+    everything.setSleepMode(SleepMode::Child);
+    everything.setEco(true);
+    everything.setStrong(true);
+    everything.setDisplayOn(false);
+    everything.setHealth(true);
+    everything.setMute(true);
+    everything.setUpDownFlow(UpDownFlow::DownFlow);
+    everything.setLeftRightFlow(LeftRightFlow::RightFlow);
+    check_matches(everything, EVERYTHING);
+#endif
+  }
+#endif
+}
+
+int main()
+{
+  test_checksum();
+  test_temperature();
+#ifndef PIONEER_UART_READ_ONLY
+  test_matches_setters();
+#endif
+  return host_test_result();
+}
@@ -0,0 +1,156 @@
+/*
+ * `DeltaEncoder` and `DeltaDecoder`: the exact bytes of keyframes and delta frames, varints longer than a byte,
+ * empty deltas, keyframes forced by the interval or by large changes, and the decoder's handling of frames it
+ * cannot use.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "state_delta.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+using namespace pioneer_uart::response;
+
+namespace
+{
+  /** Decodes `frame` with `decoder` and checks it gives back `expected` and `expected_timestamp` */
+  void check_decodes(DeltaDecoder &decoder, const uint8_t *frame, size_t length, const WytResponse &expected,
+                     uint32_t expected_timestamp)
+  {
+    WytResponse state;
+    uint32_t timestamp = 0;
+    CHECK(decoder.decode(frame, length, state, timestamp) == length);
+    CHECK(memcmp(state.bytes, expected.bytes, RESPONSE_SIZE) == 0);
+    CHECK(timestamp == expected_timestamp);
+  }
+
+  void test_frames()
+  {
+    DeltaEncoder encoder;
+    DeltaDecoder decoder;
+    uint8_t frame[DELTA_MAX_ENCODED_SIZE];
+    WytResponse state = from_bytes(SAMPLE_STATE);
+
+    // 300000 takes three varint bytes
+    size_t length = encoder.encode(state, 300000, frame, sizeof(frame));
+    CHECK(length == 1 + 3 + RESPONSE_SIZE);
+    CHECK(frame[0] == DELTA_KEYFRAME_TAG);
+    CHECK(frame[1] == 0xe0 && frame[2] == 0xa7 && frame[3] == 0x12);
+    CHECK(memcmp(frame + 4, SAMPLE_STATE, RESPONSE_SIZE) == 0);
+    check_decodes(decoder, frame, length, state, 300000);
+
+    // Bytes 30 and 45 change, in groups 3 and 5, 200 later (two varint bytes)
+    WytResponse next = state;
+    next.bytes[30] ^= 0x11;
+    next.bytes[45] ^= 0x80;
+    length = encoder.encode(next, 300200, frame, sizeof(frame));
+    const uint8_t expected[] = {DELTA_FRAME_TAG, 0xc8, 0x01, 0x28, 0x40, 0x20, 0x11, 0x80};
+    CHECK(length == sizeof(expected));
+    CHECK(memcmp(frame, expected, sizeof(expected)) == 0);
+    check_decodes(decoder, frame, length, next, 300200);
+
+    // Nothing changed: just the tag, the time and an empty group mask
+    length = encoder.encode(next, 300205, frame, sizeof(frame));
+    CHECK(length == 3);
+    CHECK(frame[0] == DELTA_FRAME_TAG && frame[1] == 5 && frame[2] == 0);
+    check_decodes(decoder, frame, length, next, 300205);
+
+    // The last byte of the state is in the last group
+    WytResponse last = next;
+    last.bytes[RESPONSE_SIZE - 1] ^= 0xff;
+    length = encoder.encode(last, 300210, frame, sizeof(frame));
+    CHECK(length == 5);
+    CHECK(frame[2] == 1 << ((RESPONSE_SIZE - 1) / 8));
+    CHECK(frame[3] == 1 << ((RESPONSE_SIZE - 1) % 8));
+    check_decodes(decoder, frame, length, last, 300210);
+
+    // A timestamp that wraps is still a small step
+    DeltaEncoder wrapping;
+    DeltaDecoder wrapping_decoder;
+    length = wrapping.encode(state, 0xfffffff0, frame, sizeof(frame));
+    check_decodes(wrapping_decoder, frame, length, state, 0xfffffff0);
+    length = wrapping.encode(state, 0x10, frame, sizeof(frame));
+    CHECK(length == 3 && frame[1] == 0x20);
+    check_decodes(wrapping_decoder, frame, length, state, 0x10);
+  }
+
+  void test_keyframes()
+  {
+    uint8_t frame[DELTA_MAX_ENCODED_SIZE];
+    WytResponse state = from_bytes(SAMPLE_STATE);
+
+    // With an interval of 4, every fourth frame is a keyframe
+    DeltaEncoder encoder(4);
+    DeltaDecoder decoder;
+    for (uint32_t idx = 0; idx < 9; ++idx)
+    {
+      state.indoor_temp_base = static_cast<uint8_t>(100 + idx);
+      size_t length = encoder.encode(state, idx * 1000, frame, sizeof(frame));
+      CHECK(frame[0] == (idx % 4 == 0 ? DELTA_KEYFRAME_TAG : DELTA_FRAME_TAG));
+      check_decodes(decoder, frame, length, state, idx * 1000);
+    }
+
+    // A reset forces one
+    encoder.reset();
+    CHECK(encoder.encode(state, 9000, frame, sizeof(frame)) == 1 + 2 + RESPONSE_SIZE);
+    CHECK(frame[0] == DELTA_KEYFRAME_TAG);
+
+    // So does a change to most bytes, which is smaller sent whole
+    WytResponse changed = state;
+    for (size_t idx = 0; idx < RESPONSE_SIZE; ++idx)
+    {
+      changed.bytes[idx] ^= 0x01;
+    }
+    size_t length = encoder.encode(changed, 9001, frame, sizeof(frame));
+    CHECK(frame[0] == DELTA_KEYFRAME_TAG);
+    check_decodes(decoder, frame, length, changed, 9001);
+
+    // Too little room for the frame
+    CHECK(encoder.encode(state, 9002, frame, 2) == 0);
+  }
+
+  void test_decoder_rejects()
+  {
+    DeltaEncoder encoder;
+    uint8_t keyframe[DELTA_MAX_ENCODED_SIZE];
+    uint8_t delta[DELTA_MAX_ENCODED_SIZE];
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    size_t keyframe_length = encoder.encode(state, 1, keyframe, sizeof(keyframe));
+    WytResponse next = state;
+    next.bytes[20] ^= 0x01;
+    next.bytes[21] ^= 0x02;
+    size_t delta_length = encoder.encode(next, 2, delta, sizeof(delta));
+    CHECK(delta[0] == DELTA_FRAME_TAG);
+
+    WytResponse decoded;
+    uint32_t timestamp;
+    // A delta without a keyframe before it
+    DeltaDecoder decoder;
+    CHECK(decoder.decode(delta, delta_length, decoded, timestamp) == 0);
+    // A truncated keyframe, and an unknown tag
+    CHECK(decoder.decode(keyframe, keyframe_length - 1, decoded, timestamp) == 0);
+    uint8_t unknown[] = {0x58, 0x01};
+    CHECK(decoder.decode(unknown, sizeof(unknown), decoded, timestamp) == 0);
+    // A varint that never ends
+    uint8_t endless[] = {DELTA_FRAME_TAG, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    CHECK(decoder.decode(endless, sizeof(endless), decoded, timestamp) == 0);
+
+    // A truncated delta leaves the previous state alone, so the whole frame still applies
+    check_decodes(decoder, keyframe, keyframe_length, state, 1);
+    CHECK(decoder.decode(delta, delta_length - 1, decoded, timestamp) == 0);
+    check_decodes(decoder, delta, delta_length, next, 2);
+
+    // After a reset, deltas need a new keyframe
+    decoder.reset();
+    CHECK(decoder.decode(delta, delta_length, decoded, timestamp) == 0);
+  }
+}
+
+int main()
+{
+  test_frames();
+  test_keyframes();
+  test_decoder_rejects();
+  return host_test_result();
+}
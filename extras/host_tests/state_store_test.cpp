@@ -0,0 +1,158 @@
+/*
+ * `StateStore` records: the round trip, rejection of corrupt and older records, the file store, and a
+ * `PioneerWYT` restoring its state from a store at construction.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "pioneer_uart.h"
+#include "host_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  /** Keeps the record in memory, and counts writes */
+  class MemoryStateStore : public StateStore
+  {
+  public:
+    uint8_t record[STATE_RECORD_SIZE];
+    bool has_record = false;
+    int writes = 0;
+
+  protected:
+    bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      if (!has_record)
+      {
+        return false;
+      }
+      memcpy(bytes, record, STATE_RECORD_SIZE);
+      return true;
+    }
+    bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      memcpy(record, bytes, STATE_RECORD_SIZE);
+      has_record = true;
+      ++writes;
+      return true;
+    }
+  };
+
+  void test_round_trip()
+  {
+    MemoryStateStore store;
+    WytResponse state;
+    CHECK(!store.load(state));
+
+    CHECK(store.save(from_bytes(SAMPLE_STATE)));
+    CHECK(store.record[0] == STATE_RECORD_MAGIC);
+    CHECK(store.record[1] == STATE_RECORD_VERSION);
+    CHECK(store.load(state));
+    CHECK(memcmp(state.bytes, SAMPLE_STATE, RESPONSE_SIZE) == 0);
+  }
+
+  void test_rejects_bad_records()
+  {
+    MemoryStateStore store;
+    WytResponse state;
+    CHECK(store.save(from_bytes(SAMPLE_STATE)));
+    uint8_t good[STATE_RECORD_SIZE];
+    memcpy(good, store.record, STATE_RECORD_SIZE);
+
+    // A bit flipped in storage
+    store.record[2 + 30] ^= 0x04;
+    CHECK(!store.load(state));
+
+    // A record from another version, even with a matching checksum
+    memcpy(store.record, good, STATE_RECORD_SIZE);
+    store.record[1] = STATE_RECORD_VERSION + 1;
+    store.record[STATE_RECORD_SIZE - 1] ^= (STATE_RECORD_VERSION + 1) ^ STATE_RECORD_VERSION;
+    CHECK(!store.load(state));
+
+    // Erased storage
+    memset(store.record, 0xff, STATE_RECORD_SIZE);
+    CHECK(!store.load(state));
+
+    memcpy(store.record, good, STATE_RECORD_SIZE);
+    CHECK(store.load(state));
+  }
+
+  void test_file_store()
+  {
+    char path[] = "/tmp/state_store_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    FileStateStore store(path);
+    WytResponse state;
+    // Nothing saved yet, so there is no file
+    CHECK(!store.load(state));
+    CHECK(store.save(from_bytes(SAMPLE_STATE)));
+    CHECK(store.load(state));
+    CHECK(memcmp(state.bytes, SAMPLE_STATE, RESPONSE_SIZE) == 0);
+
+    // A record cut short, as by a reset during a write
+    FILE *file = fopen(path, "wb");
+    CHECK(file != nullptr);
+    if (file)
+    {
+      fwrite(SAMPLE_STATE, 1, 10, file);
+      fclose(file);
+    }
+    CHECK(!store.load(state));
+    unlink(path);
+  }
+
+  void test_restore()
+  {
+    MemoryStateStore store;
+    {
+      // Without a record, there is nothing to restore
+      PioneerWYT unit(store);
+      CHECK(!unit.hasState());
+      CHECK(!unit.isStateRestored());
+    }
+
+    CHECK(store.save(from_bytes(SAMPLE_STATE)));
+    store.writes = 0;
+    BasicPioneerWYT<LoopbackTransport> unit(LoopbackTransport(), store);
+    CHECK(unit.hasState());
+    CHECK(unit.isStateRestored());
+    CHECK(unit.getMode() == OpMode::Heat);
+    CHECK(unit.getChosenTemperature() == WYT_DEGREES_C(24));
+
+    // A poll with the same settings refreshes the state without writing the store again
+    WytResponse polled = from_bytes(SAMPLE_STATE);
+    polled.indoor_temp_base += 3;
+    set_response_checksum(polled);
+    unit.getTransport().queueReceived(polled.bytes, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    CHECK(!unit.isStateRestored());
+    CHECK(store.writes == 0);
+
+    // A change of settings is saved
+    polled.mode = OpMode::Cool;
+    set_response_checksum(polled);
+    unit.getTransport().queueReceived(polled.bytes, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    CHECK(store.writes == 1);
+    WytResponse saved;
+    CHECK(store.load(saved));
+    CHECK(saved.mode == OpMode::Cool);
+  }
+}
+
+int main()
+{
+  test_round_trip();
+  test_rejects_bad_records();
+  test_file_store();
+  test_restore();
+  return host_test_result();
+}
@@ -0,0 +1,177 @@
+/*
+ * `Thermostat` against a loopback unit: waiting for a polled state, bias averaging, hysteresis, the command budget,
+ * and staging on top of settings already pending on the unit.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "thermostat.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+#ifndef PIONEER_UART_READ_ONLY
+namespace
+{
+  /** Raw indoor sensor reading for 25.1 °C */
+  const uint8_t INDOOR_25_1 = 122;
+
+  /** Keeps one record in memory */
+  class MemoryStateStore : public StateStore
+  {
+  public:
+    uint8_t record[STATE_RECORD_SIZE];
+    bool has_record = false;
+
+  protected:
+    bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      memcpy(bytes, record, STATE_RECORD_SIZE);
+      return has_record;
+    }
+    bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) override
+    {
+      memcpy(record, bytes, STATE_RECORD_SIZE);
+      has_record = true;
+      return true;
+    }
+  };
+
+  /** Makes `unit` poll a copy of the sample state with the given settings and indoor reading */
+  void poll(BasicPioneerWYT<LoopbackTransport> &unit, bool power, OpMode mode, uint8_t setpoint_half, uint8_t indoor)
+  {
+    WytResponse state = from_bytes(SAMPLE_STATE);
+    state.power = power;
+    state.mode = mode;
+    state.set_temperature_whole = setpoint_half / 2 - 16;
+    state.set_temperature_half = setpoint_half & 1;
+    state.indoor_temp_base = indoor;
+    set_response_checksum(state);
+    unit.getTransport().queueReceived(state.bytes, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    unit.getTransport().clearSent();
+  }
+
+  uint8_t sent_setpoint_half(BasicPioneerWYT<LoopbackTransport> &unit)
+  {
+    command::WytSetStateCommand command = command::from_bytes(unit.getTransport().sent());
+    return (command.set_temperature_whole - 0x6f) * 2 + command.set_temperature_half;
+  }
+
+  void test_setpoint()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    Thermostat thermostat(WYT_DEGREES_C(22));
+
+    CHECK(thermostat.stage(unit, 0) == ThermostatResult::NoState);
+    poll(unit, true, OpMode::Cool, 44, INDOOR_25_1);
+    CHECK(thermostat.stage(unit, 0) == ThermostatResult::NoSample);
+
+    // The unit reads 25.1 where the room is 23.0, so it is set to 22 + 2.1, rounded to 24.0
+    thermostat.setExternalTemperature(WYT_DEGREES_C(23), 0);
+    CHECK(thermostat.stage(unit, 0) == ThermostatResult::Staged);
+    CHECK(thermostat.getBias() >= WYT_DEGREES_C(2.05) && thermostat.getBias() <= WYT_DEGREES_C(2.15));
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.applySettings());
+    CHECK(sent_setpoint_half(unit) == 48);
+
+    // Already at 24.0, and polling again without a new reading leaves the bias alone
+    poll(unit, true, OpMode::Cool, 48, INDOOR_25_1 + 10);
+    CHECK(thermostat.stage(unit, 1000) == ThermostatResult::Holding);
+    CHECK(thermostat.stage(unit, 2000) == ThermostatResult::Holding);
+    CHECK(thermostat.getBias() >= WYT_DEGREES_C(2.05) && thermostat.getBias() <= WYT_DEGREES_C(2.15));
+
+    // Within the hysteresis of the midpoint to 24.5, so no command
+    thermostat.setTarget(WYT_DEGREES_C(22.3));
+    thermostat.setExternalTemperature(WYT_DEGREES_C(23), 3000);
+    poll(unit, true, OpMode::Cool, 48, INDOOR_25_1);
+    CHECK(thermostat.stage(unit, 3000) == ThermostatResult::Holding);
+
+    // Off, or in a mode without a setpoint, the unit is left alone
+    poll(unit, false, OpMode::Cool, 48, INDOOR_25_1);
+    CHECK(thermostat.update(unit, 4000) == ThermostatResult::Idle);
+    poll(unit, true, OpMode::Fan, 48, INDOOR_25_1);
+    CHECK(thermostat.update(unit, 4000) == ThermostatResult::Idle);
+    CHECK(unit.getTransport().sentLength() == 0);
+
+    // A stale reading is not used
+    poll(unit, true, OpMode::Cool, 40, INDOOR_25_1);
+    CHECK(thermostat.stage(unit, 4000 + THERMOSTAT_DEFAULT_MAX_SAMPLE_AGE_MS) == ThermostatResult::NoSample);
+  }
+
+  void test_budget()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    Thermostat thermostat(WYT_DEGREES_C(22), THERMOSTAT_DEFAULT_HYSTERESIS, 2, 60000);
+    uint32_t now_ms = 0;
+    thermostat.setExternalTemperature(WYT_DEGREES_C(25.1), now_ms);
+    for (uint8_t attempt = 0; attempt < 2; ++attempt)
+    {
+      poll(unit, true, OpMode::Heat, 40, INDOOR_25_1);
+      CHECK(thermostat.stage(unit, now_ms) == ThermostatResult::Staged);
+      unit.clearPendingCommand();
+    }
+    poll(unit, true, OpMode::Heat, 40, INDOOR_25_1);
+    CHECK(thermostat.stage(unit, now_ms) == ThermostatResult::OutOfBudget);
+    CHECK(thermostat.getBudget(now_ms + 59999) == 0);
+    CHECK(thermostat.getBudget(now_ms + 60000) == 1);
+    CHECK(thermostat.stage(unit, now_ms + 60000) == ThermostatResult::Staged);
+    unit.clearPendingCommand();
+
+    // A command that does not get through is given back
+    poll(unit, true, OpMode::Heat, 40, INDOOR_25_1);
+    CHECK(thermostat.getBudget(now_ms + 120000) == 1);
+    CHECK(thermostat.update(unit, now_ms + 120000) == ThermostatResult::Failed);
+    CHECK(thermostat.getBudget(now_ms + 120000) == 1);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(thermostat.update(unit, now_ms + 120000) == ThermostatResult::Applied);
+    CHECK(thermostat.getBudget(now_ms + 120000) == 0);
+  }
+
+  void test_waits_for_poll()
+  {
+    MemoryStateStore store;
+    WytResponse saved = from_bytes(SAMPLE_STATE);
+    saved.indoor_temp_base = INDOOR_25_1;
+    CHECK(store.save(saved));
+    BasicPioneerWYT<LoopbackTransport> unit(LoopbackTransport(), store);
+    CHECK(unit.isStateRestored());
+
+    // The restored indoor reading may be long out of date, so it is neither averaged into the bias nor acted on
+    Thermostat thermostat(WYT_DEGREES_C(22));
+    thermostat.setExternalTemperature(WYT_DEGREES_C(23), 0);
+    CHECK(thermostat.update(unit, 0) == ThermostatResult::NoState);
+    CHECK(unit.getTransport().sentLength() == 0);
+    CHECK(thermostat.getBudget(0) == THERMOSTAT_DEFAULT_BUDGET_BURST);
+
+    poll(unit, true, OpMode::Cool, 44, INDOOR_25_1);
+    CHECK(thermostat.stage(unit, 0) == ThermostatResult::Staged);
+    CHECK(thermostat.getBias() >= WYT_DEGREES_C(2.05) && thermostat.getBias() <= WYT_DEGREES_C(2.15));
+  }
+
+  void test_keeps_pending_settings()
+  {
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    Thermostat thermostat(WYT_DEGREES_C(24));
+    poll(unit, true, OpMode::Cool, 44, INDOOR_25_1);
+    unit.setChosenFanSpeed(FanSpeed::High);
+    thermostat.setExternalTemperature(WYT_DEGREES_C(25.1), 0);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(thermostat.update(unit, 0) == ThermostatResult::Applied);
+    command::WytSetStateCommand command = command::from_bytes(unit.getTransport().sent());
+    CHECK(command.fan_speed == command::FanSpeed::High);
+    CHECK(sent_setpoint_half(unit) == 48);
+  }
+}
+#endif
+
+int main()
+{
+#ifndef PIONEER_UART_READ_ONLY
+  test_setpoint();
+  test_budget();
+  test_waits_for_poll();
+  test_keeps_pending_settings();
+#endif
+  return host_test_result();
+}
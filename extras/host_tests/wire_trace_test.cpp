@@ -0,0 +1,167 @@
+/*
+ * `WireTracer`: the record layout, dropping the oldest records whole when the ring buffer fills, records that wrap
+ * around its end, partial dumps, and the hooks in `PioneerWYT` when built with `PIONEER_UART_TRACE`.
+ *
+ * Built and run by `run_tests.sh`.
+ */
+#include "pioneer_uart.h"
+#include "host_test.h"
+#include <string.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  /** Fills `bytes` with a pattern unique to the record numbered `id` */
+  void payload(uint8_t id, uint8_t *bytes, uint8_t length)
+  {
+    for (uint8_t idx = 0; idx < length; ++idx)
+    {
+      bytes[idx] = static_cast<uint8_t>(id * 16 + idx);
+    }
+  }
+
+  /**
+   * Checks that `dump` is exactly a sequence of whole records with the ids `first_id` onwards, each `length` bytes
+   * of payload, alternating sent and received.
+   *
+   * @return the number of records
+   */
+  size_t check_records(const uint8_t *dump, size_t dump_length, uint8_t first_id, uint8_t length)
+  {
+    size_t offset = 0;
+    size_t count = 0;
+    uint8_t expected[255];
+    while (offset < dump_length)
+    {
+      CHECK(offset + TRACE_RECORD_HEADER_SIZE <= dump_length);
+      uint8_t id = static_cast<uint8_t>(first_id + count);
+      const uint8_t *header = dump + offset;
+      CHECK(header[4] == static_cast<uint8_t>(id % 2 ? TraceDirection::Received : TraceDirection::Sent));
+      CHECK(header[5] == length);
+      payload(id, expected, length);
+      CHECK(offset + TRACE_RECORD_HEADER_SIZE + length <= dump_length);
+      CHECK(memcmp(header + TRACE_RECORD_HEADER_SIZE, expected, length) == 0);
+      offset += TRACE_RECORD_HEADER_SIZE + length;
+      ++count;
+    }
+    CHECK(offset == dump_length);
+    return count;
+  }
+
+  void record(WireTracer &tracer, uint8_t id, uint8_t length)
+  {
+    uint8_t bytes[255];
+    payload(id, bytes, length);
+    tracer.record(id % 2 ? TraceDirection::Received : TraceDirection::Sent, bytes, length);
+  }
+
+  void test_layout()
+  {
+    uint8_t buffer[64];
+    WireTracer tracer(buffer, sizeof(buffer));
+    CHECK(tracer.used() == 0);
+    record(tracer, 0, 8);
+    record(tracer, 1, 4);
+    CHECK(tracer.used() == 2 * TRACE_RECORD_HEADER_SIZE + 12);
+
+    uint8_t dump[64];
+    size_t length = tracer.dump(dump, sizeof(dump));
+    CHECK(length == tracer.used());
+    CHECK(dump[4] == static_cast<uint8_t>(TraceDirection::Sent) && dump[5] == 8);
+    CHECK(dump[TRACE_RECORD_HEADER_SIZE] == 0 && dump[TRACE_RECORD_HEADER_SIZE + 7] == 7);
+    const uint8_t *second = dump + TRACE_RECORD_HEADER_SIZE + 8;
+    CHECK(second[4] == static_cast<uint8_t>(TraceDirection::Received) && second[5] == 4);
+    CHECK(second[TRACE_RECORD_HEADER_SIZE] == 16);
+
+    // Timestamps are little-endian microseconds, so the second is not before the first
+    uint32_t first_us = dump[0] | dump[1] << 8 | dump[2] << 16 | static_cast<uint32_t>(dump[3]) << 24;
+    uint32_t second_us = second[0] | second[1] << 8 | second[2] << 16 | static_cast<uint32_t>(second[3]) << 24;
+    CHECK(static_cast<int32_t>(second_us - first_us) >= 0);
+
+    tracer.clear();
+    CHECK(tracer.used() == 0);
+    CHECK(tracer.dump(dump, sizeof(dump)) == 0);
+  }
+
+  void test_drops_whole_records()
+  {
+    // 14-byte records in a 50-byte buffer: three fit, and later ones wrap around the end
+    uint8_t buffer[50];
+    WireTracer tracer(buffer, sizeof(buffer));
+    uint8_t dump[50];
+    for (uint8_t id = 0; id < 20; ++id)
+    {
+      record(tracer, id, 8);
+      size_t length = tracer.dump(dump, sizeof(dump));
+      CHECK(length == tracer.used());
+      uint8_t held = id < 3 ? id + 1 : 3;
+      CHECK(check_records(dump, length, static_cast<uint8_t>(id + 1 - held), 8) == held);
+    }
+
+    // A bigger record drops as many of the oldest as it needs to, here two of the three
+    record(tracer, 21, 30);
+    size_t length = tracer.dump(dump, sizeof(dump));
+    CHECK(length == sizeof(buffer));
+    CHECK(check_records(dump, TRACE_RECORD_HEADER_SIZE + 8, 19, 8) == 1);
+    CHECK(check_records(dump + TRACE_RECORD_HEADER_SIZE + 8, TRACE_RECORD_HEADER_SIZE + 30, 21, 30) == 1);
+
+    // One that can never fit is skipped, and the rest are kept
+    record(tracer, 23, 50);
+    CHECK(tracer.dump(dump, sizeof(dump)) == length);
+  }
+
+  void test_partial_dump()
+  {
+    uint8_t buffer[128];
+    WireTracer tracer(buffer, sizeof(buffer));
+    for (uint8_t id = 0; id < 4; ++id)
+    {
+      record(tracer, id, 10);
+    }
+    // Room for two and a half records gets two
+    uint8_t dump[40];
+    size_t length = tracer.dump(dump, sizeof(dump));
+    CHECK(length == 2 * (TRACE_RECORD_HEADER_SIZE + 10));
+    CHECK(check_records(dump, length, 0, 10) == 2);
+    CHECK(tracer.dump(dump, TRACE_RECORD_HEADER_SIZE + 9) == 0);
+  }
+
+#ifdef PIONEER_UART_TRACE
+  void test_hooks()
+  {
+    uint8_t buffer[256];
+    WireTracer tracer(buffer, sizeof(buffer));
+    BasicPioneerWYT<LoopbackTransport> unit{LoopbackTransport()};
+    unit.setTracer(&tracer);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE - 1);
+    CHECK(!unit.pollState());
+
+    // The query, then the short read, as it came
+    uint8_t dump[256];
+    size_t length = tracer.dump(dump, sizeof(dump));
+    CHECK(length == 2 * TRACE_RECORD_HEADER_SIZE + QUERY_COMMAND_SIZE + RESPONSE_SIZE - 1);
+    CHECK(dump[4] == static_cast<uint8_t>(TraceDirection::Sent) && dump[5] == QUERY_COMMAND_SIZE);
+    CHECK(memcmp(dump + TRACE_RECORD_HEADER_SIZE, command::query_command().bytes, QUERY_COMMAND_SIZE) == 0);
+    const uint8_t *received = dump + TRACE_RECORD_HEADER_SIZE + QUERY_COMMAND_SIZE;
+    CHECK(received[4] == static_cast<uint8_t>(TraceDirection::Received) && received[5] == RESPONSE_SIZE - 1);
+    CHECK(memcmp(received + TRACE_RECORD_HEADER_SIZE, SAMPLE_STATE, RESPONSE_SIZE - 1) == 0);
+
+    unit.setTracer(nullptr);
+    unit.getTransport().queueReceived(SAMPLE_STATE, RESPONSE_SIZE);
+    CHECK(unit.pollState());
+    CHECK(tracer.dump(dump, sizeof(dump)) == length);
+  }
+#endif
+}
+
+int main()
+{
+  test_layout();
+  test_drops_whole_records();
+  test_partial_dump();
+#ifdef PIONEER_UART_TRACE
+  test_hooks();
+#endif
+  return host_test_result();
+}
@@ -0,0 +1,436 @@
+/*
+ * End-to-end benchmark that replays traffic recorded with `WireTracer` through `BasicPioneerWYT`, so throughput and
+ * latency of the whole stack can be compared across releases with realistic traffic instead of synthetic loops.
+ *
+ * The trace is split into exchanges: a poll (query, then response) or an apply (state command, query, then
+ * response). Each recorded apply is staged again with the `set*` methods and sent with `applySettings()`, and each
+ * poll is made with `pollState()`, while a stand-in for the MCU answers with the recorded responses. Exchanges whose
+ * response is missing from the trace are replayed as failures, so they cost a timeout as they did on the wire: through
+ * a pty the read really waits for it, and in memory the timeout is added to the exchange's latency instead. Back to
+ * back, it is also added to the wall time instead of being slept; when paced, it holds back the next exchange if it
+ * runs past that one's start, as a real wait would, but otherwise is absorbed by the gap between them.
+ *
+ * Build on a host with:
+ *   g++ -std=c++11 -O2 -pthread -I../../include replay_bench.cpp ../../src/pioneer_uart.cpp \
+ *     ../../src/wyt_command.cpp ../../src/wyt_response.cpp ../../src/state_store.cpp ../../src/wyt_transport.cpp \
+ *     -o replay_bench
+ *
+ * Usage:
+ *   replay_bench [-s speedup] [-r repeats] [-t timeout_ms] [--pty] trace.bin
+ *
+ * With `-s 0` (the default) exchanges are replayed back to back, as fast as possible; otherwise they are started at
+ * their recorded times divided by `speedup`. With `--pty`, bytes go through a pseudo-terminal and
+ * `PosixFdTransport`, with a thread playing the MCU, instead of through memory; this includes the kernel's share.
+ *
+ * Reports frames per second, round-trip latency percentiles per exchange, CPU time per frame of the thread driving
+ * the library, and how many commands came out different from the recorded ones.
+ */
+#include "pioneer_uart.h"
+#include "wire_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace pioneer_uart;
+
+namespace
+{
+  /** One recorded round trip with the MCU */
+  struct Exchange
+  {
+    /** Recorded start, in microseconds since the first exchange */
+    uint64_t start_us;
+    /** Every byte the controller sent, in order */
+    std::vector<uint8_t> sent;
+    /** The recorded response, empty if the MCU did not answer */
+    std::vector<uint8_t> response;
+    bool is_apply;
+  };
+
+  /** Splits a `WireTracer` dump into exchanges */
+  std::vector<Exchange> exchanges_from_trace(const std::vector<uint8_t> &trace)
+  {
+    std::vector<Exchange> exchanges;
+    uint64_t elapsed_us = 0;
+    uint32_t last_timestamp = 0;
+    bool first = true;
+    size_t offset = 0;
+    while (offset + TRACE_RECORD_HEADER_SIZE <= trace.size())
+    {
+      const uint8_t *header = trace.data() + offset;
+      size_t length = header[TRACE_RECORD_HEADER_SIZE - 1];
+      if (offset + TRACE_RECORD_HEADER_SIZE + length > trace.size())
+      {
+        break;
+      }
+      const uint8_t *payload = header + TRACE_RECORD_HEADER_SIZE;
+      offset += TRACE_RECORD_HEADER_SIZE + length;
+
+      uint32_t timestamp = header[0] | header[1] << 8 | header[2] << 16 | static_cast<uint32_t>(header[3]) << 24;
+      // Timestamps wrap like `micros()`, so accumulate the differences
+      elapsed_us += first ? 0 : static_cast<uint32_t>(timestamp - last_timestamp);
+      last_timestamp = timestamp;
+      first = false;
+
+      if (header[4] == static_cast<uint8_t>(TraceDirection::Sent))
+      {
+        // A query right after a state command is part of the same apply
+        bool continues_apply = length == QUERY_COMMAND_SIZE && !exchanges.empty() && exchanges.back().is_apply &&
+                               exchanges.back().sent.size() == STATE_COMMAND_SIZE;
+        if (length == STATE_COMMAND_SIZE || (length == QUERY_COMMAND_SIZE && !continues_apply))
+        {
+          exchanges.push_back(Exchange{elapsed_us, {}, {}, length == STATE_COMMAND_SIZE});
+        }
+        else if (!continues_apply)
+        {
+          continue;
+        }
+        exchanges.back().sent.insert(exchanges.back().sent.end(), payload, payload + length);
+      }
+      else if (header[4] == static_cast<uint8_t>(TraceDirection::Received) && length == RESPONSE_SIZE &&
+               !exchanges.empty() && exchanges.back().response.empty())
+      {
+        exchanges.back().response.assign(payload, payload + length);
+      }
+    }
+    // An apply without its query was cut off by the end of the trace
+    if (!exchanges.empty() && exchanges.back().is_apply && exchanges.back().sent.size() == STATE_COMMAND_SIZE)
+    {
+      exchanges.pop_back();
+    }
+    return exchanges;
+  }
+
+  /**
+   * Answers each exchange with its recorded response, straight from memory. A read that comes up short would have
+   * waited for the timeout on a real port, so the timeout is charged to a simulated clock instead.
+   */
+  class ReplayTransport
+  {
+  public:
+    void begin(const Exchange &exchange)
+    {
+      m_exchange = &exchange;
+      m_read = 0;
+      m_sent.clear();
+      m_simulated_ns = 0;
+    }
+    size_t write(const uint8_t *bytes, size_t length)
+    {
+      m_sent.insert(m_sent.end(), bytes, bytes + length);
+      return length;
+    }
+    void flush() {}
+    size_t read(uint8_t *bytes, size_t length)
+    {
+      size_t available = m_exchange->response.size() - m_read;
+      size_t count = std::min(length, available);
+      memcpy(bytes, m_exchange->response.data() + m_read, count);
+      m_read += count;
+      if (count < length)
+      {
+        m_simulated_ns += static_cast<uint64_t>(m_timeout_ms) * 1000000;
+      }
+      return count;
+    }
+    void setTimeout(uint32_t timeout_ms) { m_timeout_ms = timeout_ms; }
+    const std::vector<uint8_t> &sent() const { return m_sent; }
+    /** Returns the time reads of the current exchange would have spent waiting for bytes that never came */
+    uint64_t simulatedNs() const { return m_simulated_ns; }
+
+  private:
+    const Exchange *m_exchange = nullptr;
+    size_t m_read = 0;
+    std::vector<uint8_t> m_sent;
+    uint32_t m_timeout_ms = 0;
+    uint64_t m_simulated_ns = 0;
+  };
+
+  /** Plays the MCU on the master side of a pty: reads what each exchange sent, then writes its response */
+  void play_mcu(int master, const std::vector<Exchange> *exchanges, size_t repeats)
+  {
+    std::vector<uint8_t> buffer;
+    for (size_t repeat = 0; repeat < repeats; ++repeat)
+    {
+      for (const Exchange &exchange : *exchanges)
+      {
+        buffer.resize(exchange.sent.size());
+        size_t received = 0;
+        while (received < buffer.size())
+        {
+          ssize_t result = read(master, buffer.data() + received, buffer.size() - received);
+          if (result <= 0)
+          {
+            return;
+          }
+          received += result;
+        }
+        if (!exchange.response.empty() && write(master, exchange.response.data(), exchange.response.size()) < 0)
+        {
+          return;
+        }
+      }
+    }
+  }
+
+  response::OpMode response_mode(command::OpMode mode)
+  {
+    switch (mode)
+    {
+    case command::OpMode::Heat:
+      return response::OpMode::Heat;
+    case command::OpMode::Dehumidify:
+      return response::OpMode::Dehumidify;
+    case command::OpMode::Cool:
+      return response::OpMode::Cool;
+    case command::OpMode::Fan:
+      return response::OpMode::Fan;
+    default:
+      return response::OpMode::Auto;
+    }
+  }
+
+  response::FanSpeed response_fan_speed(command::FanSpeed speed)
+  {
+    switch (speed)
+    {
+    case command::FanSpeed::Low:
+      return response::FanSpeed::Low;
+    case command::FanSpeed::Medium:
+      return response::FanSpeed::Medium;
+    case command::FanSpeed::High:
+      return response::FanSpeed::High;
+    case command::FanSpeed::MidLow:
+      return response::FanSpeed::MidLow;
+    case command::FanSpeed::MidHigh:
+      return response::FanSpeed::MidHigh;
+    default:
+      return response::FanSpeed::Auto;
+    }
+  }
+
+  /** Stages a recorded state command on the unit through its setters, as an application would */
+  void stage_command(PioneerWYTBase &unit, const uint8_t *bytes)
+  {
+    command::WytSetStateCommand recorded = command::from_bytes(bytes);
+    unit.setPowerOn(recorded.power);
+    unit.setMode(response_mode(recorded.mode));
+    unit.setChosenFanSpeed(response_fan_speed(recorded.fan_speed));
+    unit.setChosenTemperature(from_half_degrees((recorded.set_temperature_whole - 0x6f) * 2 +
+                                                recorded.set_temperature_half));
+#ifndef PIONEER_UART_BASIC_SETTERS
+    unit.setEco(recorded.eco);
+    unit.setDisplayOn(recorded.display);
+    unit.setStrong(recorded.strong);
+    unit.setHealth(recorded.health);
+    unit.setMute(recorded.mute);
+    unit.setSleepMode(static_cast<SleepMode>(recorded.sleep));
+    unit.setUpDownFlow(static_cast<UpDownFlow>(recorded.up_down_flow));
+    unit.setLeftRightFlow(static_cast<LeftRightFlow>(static_cast<uint8_t>(recorded.left_right_flow) & 0x7f));
+#endif
+  }
+
+  uint64_t thread_cpu_ns()
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+  }
+
+  struct Results
+  {
+    std::vector<uint64_t> latencies_ns;
+    size_t frames = 0;
+    size_t failures = 0;
+    size_t mismatches = 0;
+    uint64_t cpu_ns = 0;
+    /** Timeouts charged by `ReplayTransport` rather than waited for */
+    uint64_t simulated_ns = 0;
+    double wall_s = 0;
+  };
+
+  /** Replays every exchange through `unit`, pacing them by `speedup` unless it is 0 */
+  template <typename Unit>
+  void replay(Unit &unit, const std::vector<Exchange> &exchanges, size_t repeats, double speedup,
+              ReplayTransport *memory, Results &results)
+  {
+    typedef std::chrono::steady_clock Clock;
+    uint64_t cpu_start = thread_cpu_ns();
+    Clock::time_point start = Clock::now();
+    // When the unit would be free again, counting the timeouts `memory` only simulated
+    Clock::time_point busy_until = start;
+    uint64_t span_us = exchanges.back().start_us + 1;
+    for (size_t repeat = 0; repeat < repeats; ++repeat)
+    {
+      for (const Exchange &exchange : exchanges)
+      {
+        if (speedup > 0)
+        {
+          uint64_t due_us = static_cast<uint64_t>((repeat * span_us + exchange.start_us) / speedup);
+          std::this_thread::sleep_until(std::max(start + std::chrono::microseconds(due_us), busy_until));
+        }
+        if (memory)
+        {
+          memory->begin(exchange);
+        }
+        Clock::time_point sent = Clock::now();
+        bool ok;
+        if (exchange.is_apply)
+        {
+          stage_command(unit, exchange.sent.data());
+          ok = unit.applySettings();
+        }
+        else
+        {
+          ok = unit.pollState();
+        }
+        Clock::time_point done = Clock::now();
+        uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(done - sent).count();
+        busy_until = done;
+        if (memory)
+        {
+          latency_ns += memory->simulatedNs();
+          results.simulated_ns += memory->simulatedNs();
+          busy_until += std::chrono::nanoseconds(memory->simulatedNs());
+        }
+        results.latencies_ns.push_back(latency_ns);
+        results.frames += (exchange.is_apply ? 2 : 1) + (exchange.response.empty() ? 0 : 1);
+        results.failures += !ok;
+        if (memory && exchange.is_apply && memory->sent() != exchange.sent)
+        {
+          ++results.mismatches;
+        }
+      }
+    }
+    // Paced, the simulated timeouts were already taken into account by the schedule
+    results.wall_s = speedup > 0 ? std::chrono::duration<double>(std::max(Clock::now(), busy_until) - start).count()
+                                 : std::chrono::duration<double>(Clock::now() - start).count() + results.simulated_ns / 1e9;
+    results.cpu_ns = thread_cpu_ns() - cpu_start;
+  }
+
+  int usage(const char *program)
+  {
+    fprintf(stderr, "usage: %s [-s speedup] [-r repeats] [-t timeout_ms] [--pty] trace.bin\n", program);
+    return 2;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  double speedup = 0;
+  size_t repeats = 1;
+  uint32_t timeout_ms = 100;
+  bool pty = false;
+  const char *path = nullptr;
+  for (int arg = 1; arg < argc; ++arg)
+  {
+    if (!strcmp(argv[arg], "-s") && arg + 1 < argc)
+    {
+      speedup = atof(argv[++arg]);
+    }
+    else if (!strcmp(argv[arg], "-r") && arg + 1 < argc)
+    {
+      repeats = std::max(1, atoi(argv[++arg]));
+    }
+    else if (!strcmp(argv[arg], "-t") && arg + 1 < argc)
+    {
+      timeout_ms = static_cast<uint32_t>(std::max(0, atoi(argv[++arg])));
+    }
+    else if (!strcmp(argv[arg], "--pty"))
+    {
+      pty = true;
+    }
+    else if (argv[arg][0] != '-' && !path)
+    {
+      path = argv[arg];
+    }
+    else
+    {
+      return usage(argv[0]);
+    }
+  }
+  if (!path)
+  {
+    return usage(argv[0]);
+  }
+
+  FILE *file = fopen(path, "rb");
+  if (!file)
+  {
+    perror(path);
+    return 1;
+  }
+  std::vector<uint8_t> trace;
+  uint8_t chunk[1 << 16];
+  size_t chunk_length;
+  while ((chunk_length = fread(chunk, 1, sizeof(chunk), file)) > 0)
+  {
+    trace.insert(trace.end(), chunk, chunk + chunk_length);
+  }
+  fclose(file);
+
+  std::vector<Exchange> exchanges = exchanges_from_trace(trace);
+  if (exchanges.empty())
+  {
+    fprintf(stderr, "%s: no exchanges found\n", path);
+    return 1;
+  }
+  size_t applies = std::count_if(exchanges.begin(), exchanges.end(), [](const Exchange &e) { return e.is_apply; });
+
+  Results results;
+  results.latencies_ns.reserve(exchanges.size() * repeats);
+  if (pty)
+  {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+      perror("posix_openpt");
+      return 1;
+    }
+    int fd = PosixFdTransport::openSerialPort(ptsname(master));
+    if (fd < 0)
+    {
+      perror(ptsname(master));
+      return 1;
+    }
+    BasicPioneerWYT<PosixFdTransport> unit{PosixFdTransport(fd, timeout_ms)};
+    std::thread mcu(play_mcu, master, &exchanges, repeats);
+    replay(unit, exchanges, repeats, speedup, nullptr, results);
+    close(fd);
+    close(master);
+    mcu.join();
+  }
+  else
+  {
+    BasicPioneerWYT<ReplayTransport> unit{ReplayTransport()};
+    unit.setResponseTimeout(timeout_ms);
+    replay(unit, exchanges, repeats, speedup, &unit.getTransport(), results);
+  }
+
+  std::vector<uint64_t> &latencies = results.latencies_ns;
+  std::sort(latencies.begin(), latencies.end());
+  printf("exchanges:           %zu (%zu polls, %zu applies) x %zu\n", exchanges.size(), exchanges.size() - applies,
+         applies, repeats);
+  printf("frames:              %zu\n", results.frames);
+  printf("failed exchanges:    %zu\n", results.failures);
+  if (!pty)
+  {
+    printf("command mismatches:  %zu\n", results.mismatches);
+    printf("simulated timeouts:  %.3f s\n", results.simulated_ns / 1e9);
+  }
+  printf("wall time:           %.3f s\n", results.wall_s);
+  printf("frames/s:            %.0f\n", results.frames / results.wall_s);
+  printf("latency p50:         %.1f us\n", latencies[latencies.size() / 2] / 1000.0);
+  printf("latency p99:         %.1f us\n", latencies[latencies.size() * 99 / 100] / 1000.0);
+  printf("latency max:         %.1f us\n", latencies.back() / 1000.0);
+  printf("CPU per frame:       %.3f us\n", results.cpu_ns / 1000.0 / results.frames);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef __ANOMALY_DETECTOR_H__
+#define __ANOMALY_DETECTOR_H__
+
+#include <stdint.h>
+#include "wyt_response.h"
+
+#define ANOMALY_MODE_GROUPS 3
+#define ANOMALY_FREQUENCY_BANDS 4
+#define ANOMALY_METRICS 4
+#define ANOMALY_HISTOGRAM_BUCKETS 16
+/** EWMA weight of each new sample is 1 / 2^shift */
+#define ANOMALY_EWMA_SHIFT 5
+#define ANOMALY_WARMUP_SAMPLES 64
+#define ANOMALY_DEFAULT_SIGMAS 4
+#define ANOMALY_TAIL_PERCENT 1
+
+namespace pioneer_uart
+{
+    /** Readings that are watched for anomalies, as bits in the result of `AnomalyDetector::observe()` */
+    enum AnomalyMetric : uint8_t
+    {
+        AnomalyDischargeTemperature = 1 << 0,
+        AnomalyCondenserCoilTemperature = 1 << 1,
+        AnomalyCompressorFrequency = 1 << 2,
+        AnomalyCurrentUsedAmps = 1 << 3,
+    };
+
+    /**
+     * Watches compressor and refrigerant related readings for sudden deviations from their usual values, as an early
+     * warning of failing compressors or refrigerant problems, in constant memory and O(1) time per sample.
+     *
+     * Normal values depend heavily on what the unit is doing, so baselines are kept separately for each combination of
+     * mode (heat, cool, other) and compressor frequency band, except for the frequency itself, which picks the band
+     * and so has one baseline per mode. Each baseline is an integer exponentially weighted mean and variance, plus a
+     * 16-bucket histogram of recent values (with bucket widths suited to each reading's range) whose counts halve when
+     * one saturates, as a decaying quantile sketch. A reading is flagged when it is more than the given number of
+     * standard deviations from the mean *and* falls outside the central 98% of the histogram, after a warm-up period
+     * for that baseline. Readings taken while the unit is off are ignored.
+     *
+     * Uses about 0.9 KB of RAM per unit with the default sizes.
+     */
+    class AnomalyDetector
+    {
+    public:
+        /** @param sigmas how many standard deviations from the mean a reading must be to be flagged; at least 1 */
+        explicit AnomalyDetector(uint8_t sigmas = ANOMALY_DEFAULT_SIGMAS);
+
+        /**
+         * Checks a new state against the baselines, then updates them with it.
+         *
+         * @return the `AnomalyMetric` bits of any readings that were flagged
+         */
+        uint8_t observe(const response::WytResponse &state);
+        /** Returns the result of the most recent `observe()`. */
+        uint8_t getLastFlags() const { return m_last_flags; }
+        /** Forgets all baselines. */
+        void reset();
+
+        /**
+         * A `StateCallback` that passes the state to the `AnomalyDetector` given as `context`, for attaching a detector
+         * to a unit's poll path with `PioneerWYT::setStateCallback()`.
+         */
+        static void onStateUpdate(const response::WytResponse &state, void *context);
+
+    private:
+        struct Baseline
+        {
+            /** Variance, in 1/256ths */
+            uint32_t variance;
+            /** Mean, in 1/256ths */
+            uint16_t mean;
+            uint16_t samples;
+            uint8_t histogram[ANOMALY_HISTOGRAM_BUCKETS];
+        };
+
+        /** Baselines of every metric but the compressor frequency, by mode group and frequency band */
+        Baseline m_baselines[ANOMALY_MODE_GROUPS][ANOMALY_FREQUENCY_BANDS][ANOMALY_METRICS - 1];
+        /** Baselines of the compressor frequency, by mode group */
+        Baseline m_frequency_baselines[ANOMALY_MODE_GROUPS];
+        uint8_t m_sigmas;
+        uint8_t m_last_flags;
+
+        bool check(const Baseline &baseline, uint8_t value, uint8_t value_bucket) const;
+        static void update(Baseline &baseline, uint8_t value, uint8_t value_bucket);
+    };
+}
+#endif
@@ -0,0 +1,155 @@
+#ifndef __CIRCUIT_BREAKER_H__
+#define __CIRCUIT_BREAKER_H__
+
+#include <stdint.h>
+#include "pioneer_uart.h"
+
+#define CIRCUIT_BREAKER_DEFAULT_FAILURE_THRESHOLD 3
+#define CIRCUIT_BREAKER_DEFAULT_TIMEOUT_MS 1000UL
+#define CIRCUIT_BREAKER_DEFAULT_PROBE_TIMEOUT_MS 150UL
+#define CIRCUIT_BREAKER_DEFAULT_BASE_BACKOFF_MS 1000UL
+#define CIRCUIT_BREAKER_DEFAULT_MAX_BACKOFF_MS 300000UL
+/** Shortest response timeout worth attempting an operation with, covering the MCU's usual latency */
+#define CIRCUIT_BREAKER_MIN_TIMEOUT_MS 30UL
+/** Time on the wire for a number of bytes at `WYT_BAUD_RATE`, with 10 bits per byte, rounded up */
+#define CIRCUIT_BREAKER_TRANSFER_MS(bytes) (((bytes) * 10000UL + WYT_BAUD_RATE - 1) / WYT_BAUD_RATE)
+/** Time on the wire for a poll: the query and the response */
+#define CIRCUIT_BREAKER_POLL_TRANSFER_MS CIRCUIT_BREAKER_TRANSFER_MS(QUERY_COMMAND_SIZE + RESPONSE_SIZE)
+/** Time on the wire for an apply: the state command, the query and the response */
+#define CIRCUIT_BREAKER_APPLY_TRANSFER_MS \
+    CIRCUIT_BREAKER_TRANSFER_MS(STATE_COMMAND_SIZE + QUERY_COMMAND_SIZE + RESPONSE_SIZE)
+#define CIRCUIT_BREAKER_MAX_BACKOFF_SHIFT 20
+
+namespace pioneer_uart
+{
+    enum class CircuitState : uint8_t
+    {
+        /** The unit is responding; operations are attempted, with backoff after failures */
+        Closed,
+        /** The unit stopped responding; operations are skipped until the next probe is due */
+        Open,
+        /** A probe is being attempted, to see whether the unit responds again */
+        HalfOpen,
+    };
+
+    enum class AttemptResult : uint8_t
+    {
+        /** Not attempted, because the unit is backing off after a failure or is parked */
+        Skipped,
+        /** Not attempted, because there was not enough time left before the deadline */
+        OutOfTime,
+        Succeeded,
+        Failed,
+    };
+
+    /**
+     * Decides when to talk to one unit, so that units that stop responding cost almost no bus time while the
+     * rest keep their poll rate. Keep one per unit, and either wrap operations in `poll()`/`apply()`, or call
+     * `shouldAttempt()`, `getTimeout()` and `recordSuccess()`/`recordFailure()` around them.
+     *
+     * After a failure, the next attempt waits for an exponentially growing backoff with random jitter, so retries
+     * of many units do not line up. After `failure_threshold` consecutive failures the circuit opens and the unit
+     * is parked, then probed after each backoff with the short probe timeout; the backoff keeps growing, up to
+     * `max_backoff_ms`, until a probe succeeds and closes the circuit again.
+     *
+     * All times are from a free-running millisecond clock such as `millis()`, and may wrap.
+     */
+    class CircuitBreaker
+    {
+    public:
+        /**
+         * @param failure_threshold consecutive failures after which the circuit opens
+         * @param timeout_ms response timeout for normal operations
+         * @param probe_timeout_ms response timeout for probes of an open circuit
+         * @param base_backoff_ms backoff after the first failure, doubling with each further one
+         * @param max_backoff_ms longest backoff
+         */
+        explicit CircuitBreaker(uint8_t failure_threshold = CIRCUIT_BREAKER_DEFAULT_FAILURE_THRESHOLD,
+                                uint32_t timeout_ms = CIRCUIT_BREAKER_DEFAULT_TIMEOUT_MS,
+                                uint32_t probe_timeout_ms = CIRCUIT_BREAKER_DEFAULT_PROBE_TIMEOUT_MS,
+                                uint32_t base_backoff_ms = CIRCUIT_BREAKER_DEFAULT_BASE_BACKOFF_MS,
+                                uint32_t max_backoff_ms = CIRCUIT_BREAKER_DEFAULT_MAX_BACKOFF_MS);
+
+        /** Seeds the jitter; give each unit a different seed (e.g. its index) so their backoffs differ. */
+        void seed(uint32_t seed);
+
+        /**
+         * Returns whether an operation should be attempted now. When a parked unit is due for a probe, this moves
+         * the circuit to `CircuitState::HalfOpen`, and the attempt is the probe.
+         */
+        bool shouldAttempt(uint32_t now_ms);
+        /** Returns the response timeout for the next attempt: shorter when it is a probe. */
+        uint32_t getTimeout() const;
+        void recordSuccess();
+        void recordFailure(uint32_t now_ms);
+        /** Closes the circuit and forgets all failures, e.g. after the unit's dongle was replaced. */
+        void reset();
+
+        CircuitState getState() const { return m_state; }
+        uint8_t getConsecutiveFailures() const { return m_consecutive_failures; }
+        /** Returns when the next attempt is allowed, if the last one failed. */
+        uint32_t getNextAttemptMs() const { return m_next_attempt_ms; }
+
+        /**
+         * Polls the unit if an attempt is due and there is time for it before the deadline. The response timeout is
+         * capped at what is left of the budget once the frames' time on the wire is taken off, and the attempt is
+         * skipped if that leaves less than `CIRCUIT_BREAKER_MIN_TIMEOUT_MS`. The timeout bounds each wait for a
+         * byte, so the deadline holds as long as the unit sends its response in one burst, as it does; a unit that
+         * stalls in the middle of a response can overrun it.
+         *
+         * @tparam Unit `PioneerWYT` on Arduino, or a `BasicPioneerWYT` whose transport has `setTimeout()`
+         * @param budget_ms time left until the caller's deadline, e.g. the end of the current polling round
+         */
+        template <typename Unit>
+        AttemptResult poll(Unit &unit, uint32_t now_ms, uint32_t budget_ms = UINT32_MAX)
+        {
+            return attempt(unit, &Unit::pollState, CIRCUIT_BREAKER_POLL_TRANSFER_MS, now_ms, budget_ms);
+        }
+#ifndef PIONEER_UART_READ_ONLY
+        /** Like `poll()`, for sending the unit's pending command with `applySettings()`. */
+        template <typename Unit>
+        AttemptResult apply(Unit &unit, uint32_t now_ms, uint32_t budget_ms = UINT32_MAX)
+        {
+            return attempt(unit, &Unit::applySettings, CIRCUIT_BREAKER_APPLY_TRANSFER_MS, now_ms, budget_ms);
+        }
+#endif
+
+    private:
+        uint32_t m_timeout_ms;
+        uint32_t m_probe_timeout_ms;
+        uint32_t m_base_backoff_ms;
+        uint32_t m_max_backoff_ms;
+        uint32_t m_next_attempt_ms;
+        uint32_t m_random;
+        uint8_t m_failure_threshold;
+        uint8_t m_consecutive_failures;
+        CircuitState m_state;
+
+        uint32_t nextBackoff();
+
+        template <typename Unit>
+        AttemptResult attempt(Unit &unit, bool (Unit::*operation)(), uint32_t transfer_ms, uint32_t now_ms,
+                              uint32_t budget_ms)
+        {
+            if (budget_ms < transfer_ms + CIRCUIT_BREAKER_MIN_TIMEOUT_MS)
+            {
+                return AttemptResult::OutOfTime;
+            }
+            if (!shouldAttempt(now_ms))
+            {
+                return AttemptResult::Skipped;
+            }
+            uint32_t timeout_ms = getTimeout();
+            uint32_t wait_budget_ms = budget_ms - transfer_ms;
+            unit.setResponseTimeout(timeout_ms < wait_budget_ms ? timeout_ms : wait_budget_ms);
+            if ((unit.*operation)())
+            {
+                recordSuccess();
+                return AttemptResult::Succeeded;
+            }
+            recordFailure(now_ms);
+            return AttemptResult::Failed;
+        }
+    };
+}
+#endif
@@ -0,0 +1,94 @@
+#ifndef __ENERGY_METER_H__
+#define __ENERGY_METER_H__
+
+#include <stdint.h>
+#include "wyt_response.h"
+
+#define ENERGY_METER_DAYS 7
+#define ENERGY_METER_DEFAULT_MAX_GAP_MS 300000UL
+#define WATT_MS_PER_WATT_HOUR 3600000UL
+
+namespace pioneer_uart
+{
+    /** An amount of energy, in fixed point, so it can be accumulated for years without losing small increments. */
+    struct EnergyTotal
+    {
+        /** Whole watt-hours */
+        uint32_t watt_hours;
+        /** Energy below one watt-hour, in watt-milliseconds (always below 3,600,000) */
+        uint32_t watt_ms;
+
+        void add(uint64_t watt_ms_to_add);
+        float kilowattHours() const { return watt_hours / 1000.0f + watt_ms / 3.6e9f; }
+    };
+
+    /**
+     * Integrates the unit's power draw over time on the device, so energy reports don't need every raw sample.
+     * Power is estimated as supply voltage × current (i.e. apparent power, as the unit does not report power
+     * factor), and integrated with the trapezoidal rule between consecutive samples, in O(1) per sample.
+     * Totals are kept overall, per operating mode, and for each of the last `ENERGY_METER_DAYS` days.
+     *
+     * When samples are further apart than the maximum gap (e.g. the unit stopped responding), the interval is not
+     * integrated, because nothing is known about the draw during it; its duration is added to `getUnaccountedMs()`
+     * instead, and integration restarts from the next sample.
+     *
+     * Samples carry a day number but no time of day, so the interval that spans midnight cannot be split; it is
+     * credited to the new day, along with the rest of the interval ending at its first sample. With samples seconds
+     * apart, that shifts at most one interval's energy between days.
+     */
+    class EnergyMeter
+    {
+    public:
+        /** @param max_gap_ms longest interval between samples that is still integrated */
+        explicit EnergyMeter(uint32_t max_gap_ms = ENERGY_METER_DEFAULT_MAX_GAP_MS);
+
+        /**
+         * Adds a sample of the unit's power draw.
+         *
+         * @param now_ms time of the sample, e.g. from `millis()`; wrapping around is handled
+         * @param day the current day number, from any calendar the caller likes (e.g. days since epoch); when it
+         * goes forward, the per-day totals move on by that many days; when it goes back (e.g. the clock was
+         * corrected), the current day's total carries on under the new day number, so no energy is lost
+         * @param volts supply voltage, as from `getSupplyVoltage()`
+         * @param amps current draw, as from `getCurrentUsedAmps()`
+         * @param mode operating mode during the sample; the interval up to the next sample is attributed to it
+         * @param power whether the unit is on; intervals while off are attributed to standby instead of a mode
+         */
+        void addSample(uint32_t now_ms, uint16_t day, uint8_t volts, uint8_t amps, response::OpMode mode, bool power);
+        /** Adds a sample taken from a unit's state. See the other `addSample()`. */
+        void addSample(const response::WytResponse &state, uint32_t now_ms, uint16_t day);
+
+        /** Returns the energy used since construction or the last `reset()`. */
+        const EnergyTotal &getTotal() const { return m_total; }
+        /** Returns the energy used while the unit was on in the given mode. */
+        EnergyTotal getForMode(response::OpMode mode) const;
+        /** Returns the energy used while the unit was off. */
+        const EnergyTotal &getStandby() const { return m_by_mode[0]; }
+        /**
+         * Returns the energy used on a recent day.
+         *
+         * @param days_ago 0 for the current day, 1 for the day before, and so on, up to `ENERGY_METER_DAYS - 1`
+         */
+        EnergyTotal getForDay(uint8_t days_ago) const;
+        /** Returns the total time spent in gaps between samples, which was not integrated. */
+        uint32_t getUnaccountedMs() const { return m_unaccounted_ms; }
+        /** Clears all totals, and starts integrating afresh from the next sample. */
+        void reset();
+
+    private:
+        EnergyTotal m_total;
+        /** Standby at 0, then each mode at its `response::OpMode` value */
+        EnergyTotal m_by_mode[6];
+        EnergyTotal m_by_day[ENERGY_METER_DAYS];
+        uint32_t m_max_gap_ms;
+        uint32_t m_unaccounted_ms;
+        uint32_t m_last_ms;
+        uint16_t m_last_power_va;
+        uint16_t m_day;
+        uint8_t m_today;
+        uint8_t m_last_mode_index;
+        bool m_has_last;
+        bool m_has_day;
+    };
+}
+#endif
@@ -0,0 +1,168 @@
+#ifndef __MQTT_BRIDGE_H__
+#define __MQTT_BRIDGE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pioneer_uart.h"
+#ifndef PIONEER_UART_READ_ONLY
+#include "reconciler.h"
+#endif
+
+#ifndef MQTT_BRIDGE_BUFFER_SIZE
+#define MQTT_BRIDGE_BUFFER_SIZE 1280
+#endif
+#define MQTT_BRIDGE_MAX_TOPIC_SIZE 96
+/** Longest name in a discovery config, after escaping it for JSON */
+#define MQTT_BRIDGE_MAX_NAME_SIZE 64
+/** Range of `chosen_temperature` commands and of the Home Assistant thermostat, as the unit's remote allows */
+#define MQTT_BRIDGE_MIN_TEMPERATURE 16
+#define MQTT_BRIDGE_MAX_TEMPERATURE 30
+#define MQTT_BRIDGE_DEFAULT_DEBOUNCE_MS 500UL
+#define MQTT_BRIDGE_DEFAULT_FULL_INTERVAL_MS 300000UL
+#define MQTT_BRIDGE_DISCOVERY_PREFIX "homeassistant"
+
+namespace pioneer_uart
+{
+    /**
+     * The MQTT client used by `MqttBridge`, so that any client library (PubSubClient on Arduino, or libmosquitto
+     * against a local broker on a host) can be plugged in with a small adapter. Incoming messages are passed to
+     * `MqttBridge::handleMessage()` by the caller.
+     */
+    class MqttClient
+    {
+    public:
+        virtual ~MqttClient() {}
+        /** @return true if the message was queued or sent */
+        virtual bool publish(const char *topic, const char *payload, size_t length, bool retain) = 0;
+        virtual bool subscribe(const char *topic_filter) = 0;
+    };
+
+    /**
+     * Publishes a unit's state to MQTT, and changes its settings from command topics.
+     *
+     * State is published as the JSON of `serializer::to_json()` to `<base>/state`. Only fields that changed since
+     * the last publish are sent, all in one message, and nothing is sent when nothing changed. A full state is
+     * published, retained, after `begin()`, every `full_interval_ms`, and whenever power or mode changes (so
+     * consumers that combine them, like the Home Assistant mode, always see both).
+     *
+     * Commands are received on `<base>/set/<key>`, where the keys and values are those of the state JSON (e.g.
+     * `<base>/set/mode` with `cool`, or `<base>/set/chosen_temperature` with `24.5`, from 16 to 30); booleans may be
+     * `on`/`off`, `true`/`false` or `1`/`0`, and `mode` also takes the Home Assistant modes `off`, `dry` and
+     * `fan_only`. Commands are collected until none has arrived for `debounce_ms`, then the settings that differ from
+     * the unit's are sent in a single state command, so dragging a temperature slider sends one command. If sending
+     * fails, the commands are kept and tried again on the next `loop()`, against the unit's state by then.
+     *
+     * Call `loop()` regularly, after polling the unit.
+     */
+    class MqttBridge
+    {
+    public:
+        /**
+         * @param client connected client to publish and subscribe with
+         * @param base_topic prefix of all topics, e.g. `pioneer/living_room`; it is copied
+         * @param debounce_ms how long to wait after the last command before applying commands
+         * @param full_interval_ms how often to publish the full state
+         */
+        MqttBridge(MqttClient &client, const char *base_topic, uint32_t debounce_ms = MQTT_BRIDGE_DEFAULT_DEBOUNCE_MS,
+                   uint32_t full_interval_ms = MQTT_BRIDGE_DEFAULT_FULL_INTERVAL_MS);
+
+        /**
+         * Subscribes to the command topics, and makes the next publish a full one. Call after every (re)connect.
+         *
+         * @return false if subscribing failed
+         */
+        bool begin();
+
+        /**
+         * Publishes whatever changed in `state` since the last publish, as described for the class.
+         *
+         * @return false if publishing failed; the changes are then sent with the next publish
+         */
+        bool publishState(const WytResponse &state, uint32_t now_ms);
+
+        /**
+         * Writes a Home Assistant MQTT discovery config for a climate entity controlling this bridge's unit.
+         *
+         * @param unique_id identifies the unit in Home Assistant; letters, digits, `_` and `-` only
+         * @param name name shown in Home Assistant; it is escaped for JSON, and must fit in `MQTT_BRIDGE_MAX_NAME_SIZE`
+         * once escaped
+         * @param capacity size of `out`, including space for the terminating `\0`
+         * @return the length of the config written (excluding the `\0`), or 0 if it did not fit or `unique_id` has
+         * other characters
+         */
+        size_t discoveryConfig(char *out, size_t capacity, const char *unique_id, const char *name) const;
+        /**
+         * Publishes the config from `discoveryConfig()`, retained, to
+         * `homeassistant/climate/<unique_id>/config`.
+         *
+         * @return false if the config did not fit in `MQTT_BRIDGE_BUFFER_SIZE`, or publishing failed
+         */
+        bool publishDiscovery(const char *unique_id, const char *name);
+
+#ifndef PIONEER_UART_READ_ONLY
+        /**
+         * Handles an incoming message, collecting it if it is a valid command for this bridge.
+         *
+         * @return true if the message was a command for this bridge, even if its value was invalid
+         */
+        bool handleMessage(const char *topic, const uint8_t *payload, size_t length, uint32_t now_ms);
+        /** Returns whether commands have been collected, but not yet applied. */
+        bool hasPendingCommands() const { return m_has_commands; }
+#endif
+
+        /**
+         * Applies collected commands once they have settled, then publishes any state changes.
+         *
+         * @tparam Unit `PioneerWYT` on Arduino, or any `BasicPioneerWYT`
+         * @return false if applying commands or publishing failed
+         */
+        template <typename Unit>
+        bool loop(Unit &unit, uint32_t now_ms)
+        {
+            if (!unit.hasState())
+            {
+                return true;
+            }
+            bool ok = true;
+#ifndef PIONEER_UART_READ_ONLY
+            if (m_has_commands && now_ms - m_last_command_ms >= m_debounce_ms)
+            {
+                if (m_commands.stageOn(unit))
+                {
+                    ok = unit.applySettings();
+                }
+                if (ok)
+                {
+                    m_commands = DesiredState();
+                    m_has_commands = false;
+                }
+            }
+#endif
+            return publishState(unit.getRawState(), now_ms) && ok;
+        }
+
+    private:
+        MqttClient &m_client;
+        char m_base_topic[MQTT_BRIDGE_MAX_TOPIC_SIZE];
+        size_t m_base_topic_length;
+        uint32_t m_full_interval_ms;
+        uint32_t m_last_full_ms;
+        WytResponse m_published;
+        bool m_full_due;
+#ifndef PIONEER_UART_READ_ONLY
+        uint32_t m_debounce_ms;
+        uint32_t m_last_command_ms;
+        DesiredState m_commands;
+        bool m_has_commands;
+#endif
+        char m_buffer[MQTT_BRIDGE_BUFFER_SIZE];
+
+        /** Writes `<base><suffix>` into `out`, returning false if it did not fit */
+        bool topic(char *out, const char *suffix) const;
+#ifndef PIONEER_UART_READ_ONLY
+        /** Adds a command to `m_commands`, returning false if it was not valid */
+        bool collectCommand(const char *key, const char *value, size_t length);
+#endif
+    };
+}
+#endif
@@ -4,59 +4,91 @@
 #ifdef USE_ARDUINO
 #include <Arduino.h>
 #endif
+#include "pioneer_uart_config.h"
 #include "wyt_response.h"
 #include "wyt_command.h"
+#include "state_store.h"
+#include "wire_trace.h"
+#include "wyt_transport.h"
 
 namespace pioneer_uart
 {
 
 #define WYT_BAUD_RATE 9600
 
+#ifdef PIONEER_UART_FIXED_POINT
+    /** Tenths of a degree C */
+    using DegreesC = int16_t;
+#define WYT_DEGREES_C(degrees) static_cast<pioneer_uart::DegreesC>((degrees) * 10)
+#else
     using DegreesC = float;
+#define WYT_DEGREES_C(degrees) static_cast<pioneer_uart::DegreesC>(degrees)
+#endif
     using namespace response;
 
+    /** Converts half degrees C, as the unit stores temperature settings, to `DegreesC`. */
+    inline DegreesC from_half_degrees(uint8_t temp_half)
+    {
+#ifdef PIONEER_UART_FIXED_POINT
+        return temp_half * 5;
+#else
+        return temp_half / 2.0f;
+#endif
+    }
+    /** Converts `DegreesC` to half degrees C, rounding down to the unit's 0.5 °C resolution. */
+    inline uint8_t to_half_degrees(DegreesC temperature)
+    {
+#ifdef PIONEER_UART_FIXED_POINT
+        return static_cast<uint8_t>(temperature / 5);
+#else
+        return static_cast<uint8_t>(temperature * 2);
+#endif
+    }
+
     /**
-     * Main interface for interacting with a Pioneer WYT control MCU.
-     * The internal object state, accessed via `is*` and `get*` methods, is
-     * populated by `pollState()` or `deserializeState()`.
-     * The pending command state, updated using the `set*` methods, is seeded
-     * from the internal object state when the first `set*` method is called,
-     * and then gets sent to the Pioneer unit on `applySettings()`, or by using
-     * `serializePendingState()` and sending the command manually.
+     * Called with the new state after every successful state update.
+     *
+     * @param context the pointer given to `setStateCallback()`
      */
-    class PioneerWYT
+    typedef void (*StateCallback)(const WytResponse &state, void *context);
+
+    /**
+     * What `PioneerWYT` and `BasicPioneerWYT` share: the unit's state, the pending command, and the protocol, without
+     * any connection to the unit. It has no `pollState()` or `applySettings()`, so a function taking a
+     * `PioneerWYTBase &` can only read the state and stage settings, and anything that talks to the unit is a
+     * template over the unit's type (like `Thermostat::update()`), so it always goes through that unit's own
+     * connection.
+     */
+    class PioneerWYTBase
     {
     public:
-        /** Constructs a new Pioneer control object without any serial communications capabilities. */
-        PioneerWYT();
-
-        /** Destructor cleans up any pending state command that might have been created, without sending */
-        ~PioneerWYT();
-#ifdef USE_ARDUINO
+#ifdef PIONEER_UART_TRACE
         /**
-         * Constructs a new Pioneer control object that can communicate with a Pioneer WYT MCU over a serial connection.
-         * Note the serial connection must be 9600 baud, `8E1`.
+         * Records every frame sent and received over the serial connection into `tracer`.
+         * Only available when the library is built with `PIONEER_UART_TRACE` defined.
+         *
+         * @param tracer the tracer to record into, or `nullptr` to stop tracing
          */
-        PioneerWYT(Stream &serial);
+        void setTracer(WireTracer *tracer);
+#endif
         /**
-         * Requests a report of the current state from the WYT's MCU over the serial connection, and updates
-         * this object's internal state from the response.
+         * Sets a function to be called after every successful state update (from `pollState()`, `applySettings()`
+         * or `deserializeState()`), for attaching processing such as an `EnergyMeter` to the poll path.
+         * It is not called when state is restored from a `StateStore`.
          *
-         * @return true on success, false on errors
+         * @param callback the function to call, or `nullptr` to stop calling it
+         * @param context passed through to `callback`
          */
-        bool pollState();
+        void setStateCallback(StateCallback callback, void *context = nullptr);
+        /** Returns whether there is any state to report, either from a state update or restored from a `StateStore`. */
+        bool hasState() const;
         /**
-         * Sends the desired new state to the WYT's MCU in order to change settings.
-         * Commands work by sending the entire desired state. Pending command states are built up from the last polled
-         * state and any `set*` methods on this module. The caller is responsible for ensuring there has been a recent
-         * successful `pollState()` call before changing any settings and calling this method.
-         * On a successful call, the existing pending command will be cleared, and `pollState()` will be called to
-         * pick up the new state changes from the MCU.
-         *
-         * @return true on success, false on errors (including those from the `pollState()` call)
+         * Returns whether the current state was restored from a `StateStore` and has not yet been refreshed by a
+         * state update. Restored settings are usually still accurate, but sensor readings will be out of date.
          */
-        bool applySettings();
-#endif
+        bool isStateRestored() const;
+        /** Returns the undecoded state, as of the last state update, for bulk processing of many fields at once. */
+        const WytResponse &getRawState() const;
         /** Returns whether the unit's power is on, as of the last state update. */
         bool isPowerOn() const;
         /** Returns whether the unit's "eco" mode is on, as of the last state update. */
@@ -79,12 +111,14 @@ namespace pioneer_uart
         bool isAntifreeze() const;
         /** Returns whether the unit is currently heating, as of the last state update. */
         bool isHeatMode() const;
+#ifndef PIONEER_UART_READ_ONLY
         /**
          * Fills the array with a byte representation of the pending new state command, if any.
          *
          * @return false if there is no new state command pending.
          */
         bool serializePendingState(uint8_t bytes[STATE_COMMAND_SIZE]) const;
+#endif
         /**
          * Sets the state of this object from bytes returned from the serial line.
          * This is analogous to the `pollState()` function, if this instance is managing serial connections.
@@ -126,11 +160,19 @@ namespace pioneer_uart
         /** Returns which sleep mode is currently active on the unit, as of the last state update. */
         SleepMode getSleepMode() const;
 
+#ifndef PIONEER_UART_READ_ONLY
         /** Sets whether the unit's power should be on.
          *
          * @param power `true` to turn on, `false` to turn off.
          */
         void setPowerOn(bool power);
+        /** Sets which mode (heat, cooling, fan only, etc) the unit should be in. */
+        void setMode(OpMode mode);
+        /** Sets which fan speed the indoor unit should run at. */
+        void setChosenFanSpeed(FanSpeed speed);
+        /** Sets the desired temperature for the room. */
+        void setChosenTemperature(DegreesC temperature);
+#ifndef PIONEER_UART_BASIC_SETTERS
         /** Sets whether the unit's "eco" mode should be on.
          *
          * @param eco `true` to turn on eco mode, `false` to turn off.
@@ -156,36 +198,227 @@ namespace pioneer_uart
          * @param mute `true` to silence the beeper, `false` to enable the beeper.
          */
         void setMute(bool mute);
-        /** Sets which mode (heat, cooling, fan only, etc) the unit should be in. */
-        void setMode(OpMode mode);
-        /** Sets which fan speed the indoor unit should run at. */
-        void setChosenFanSpeed(FanSpeed speed);
-        /** Sets the desired temperature for the room. */
-        void setChosenTemperature(DegreesC temperature);
         /** Sets how the vent louvers should move vertically. */
         void setUpDownFlow(UpDownFlow flow);
         /** Sets how the vent louvers should move horizontally. */
         void setLeftRightFlow(LeftRightFlow flow);
         /** Sets the sleep mode, or turns it off. */
         void setSleepMode(SleepMode sleep);
+#endif
+#endif
         /** Clears any settings that have been set, but not applied (sent to the unit). */
         void clearPendingCommand();
 
+    protected:
+        /** Constructs a unit without any state. */
+        PioneerWYTBase();
+        /** Constructs a unit, restoring the last saved state from `store` if there is one. */
+        PioneerWYTBase(StateStore &store);
+        /** Polls the MCU over `transport`, as described for `pollState()`. */
+        template <typename Transport>
+        bool pollStateWith(Transport &transport)
+        {
+            command::WytQueryCommand query = command::query_command();
+            WYT_TRACE(m_tracer, TraceDirection::Sent, query.bytes, QUERY_COMMAND_SIZE);
+            transport.write(query.bytes, QUERY_COMMAND_SIZE);
+            transport.flush();
+            uint8_t state_buf[RESPONSE_SIZE];
+            size_t bytes_read = transport.read(state_buf, RESPONSE_SIZE);
+            WYT_TRACE(m_tracer, TraceDirection::Received, state_buf, bytes_read);
+            if (bytes_read < RESPONSE_SIZE)
+            {
+                return false;
+            }
+            WytResponse state = from_bytes(state_buf);
+#ifndef PIONEER_UART_NO_VALIDATION
+            if (!is_valid(state))
+            {
+                return false;
+            }
+#endif
+            updateState(state);
+            return true;
+        }
+#ifndef PIONEER_UART_READ_ONLY
+        /** Sends the pending command over `transport`, as described for `applySettings()`. */
+        template <typename Transport>
+        bool applySettingsWith(Transport &transport)
+        {
+            if (!m_has_pending_command)
+            {
+                return false;
+            }
+            set_checksum(&m_pending_command);
+            WYT_TRACE(m_tracer, TraceDirection::Sent, m_pending_command.bytes, STATE_COMMAND_SIZE);
+            transport.write(m_pending_command.bytes, STATE_COMMAND_SIZE);
+            transport.flush();
+            clearPendingCommand();
+            return pollStateWith(transport);
+        }
+#endif
+        /** Sends a complete command over `transport`, as described for `sendFrame()`. */
+        template <typename Transport>
+        bool sendFrameWith(Transport &transport, const uint8_t frame[STATE_COMMAND_SIZE])
+        {
+            WYT_TRACE(m_tracer, TraceDirection::Sent, frame, STATE_COMMAND_SIZE);
+            transport.write(frame, STATE_COMMAND_SIZE);
+            transport.flush();
+            clearPendingCommand();
+            return pollStateWith(transport);
+        }
+
     private:
         WytResponse m_state;
-        command::WytStateCommand *m_pending_command;
-#ifdef USE_ARDUINO
-        Stream *m_serial;
+#ifndef PIONEER_UART_READ_ONLY
+        command::WytSetStateCommand m_pending_command;
+        bool m_has_pending_command = false;
+#endif
+        StateStore *m_store = nullptr;
+        StateCallback m_state_callback = nullptr;
+        void *m_state_callback_context = nullptr;
+        bool m_has_state = false;
+        bool m_state_restored = false;
+#ifdef PIONEER_UART_TRACE
+        WireTracer *m_tracer = nullptr;
 #endif
 
+        void restoreState();
+        void updateState(const WytResponse &state);
+#ifndef PIONEER_UART_READ_ONLY
         void initPendingCommand();
         inline void checkOrInitCommand()
         {
-            if (!m_pending_command)
+            if (!m_has_pending_command)
             {
                 initPendingCommand();
             }
         }
+#endif
+    };
+
+    /**
+     * Main interface for interacting with a Pioneer WYT control MCU.
+     * The internal object state, accessed via `is*` and `get*` methods, is
+     * populated by `pollState()` or `deserializeState()`.
+     * The pending command state, updated using the `set*` methods, is seeded
+     * from the internal object state when the first `set*` method is called,
+     * and then gets sent to the Pioneer unit on `applySettings()`, or by using
+     * `serializePendingState()` and sending the command manually.
+     * If a `StateStore` is given, the last good state is saved to it whenever the unit's settings change,
+     * and restored from it at construction, so `set*` methods can be used before the first poll after a reset.
+     * Which methods exist, and whether temperatures are `float`, can be chosen at compile time in
+     * `pioneer_uart_config.h`.
+     * To communicate over something other than an Arduino `Stream`, or to avoid virtual calls on the byte path,
+     * use `BasicPioneerWYT` with a transport instead.
+     */
+    class PioneerWYT : public PioneerWYTBase
+    {
+    public:
+        /** Constructs a new Pioneer control object without any serial communications capabilities. */
+        PioneerWYT();
+        /**
+         * Constructs a new Pioneer control object without any serial communications capabilities, restoring
+         * the last saved state from `store` if there is one.
+         */
+        PioneerWYT(StateStore &store);
+#ifdef USE_ARDUINO
+        /**
+         * Constructs a new Pioneer control object that can communicate with a Pioneer WYT MCU over a serial connection.
+         * Note the serial connection must be 9600 baud, `8E1`.
+         */
+        PioneerWYT(Stream &serial);
+        /**
+         * Constructs a new Pioneer control object that can communicate with a Pioneer WYT MCU over a serial connection,
+         * restoring the last saved state from `store` if there is one.
+         * Note the serial connection must be 9600 baud, `8E1`.
+         */
+        PioneerWYT(Stream &serial, StateStore &store);
+        /**
+         * Requests a report of the current state from the WYT's MCU over the serial connection, and updates
+         * this object's internal state from the response.
+         *
+         * @return true on success, false on errors
+         */
+        bool pollState();
+#ifndef PIONEER_UART_READ_ONLY
+        /**
+         * Sends the desired new state to the WYT's MCU in order to change settings.
+         * Commands work by sending the entire desired state. Pending command states are built up from the last polled
+         * state and any `set*` methods on this module. The caller is responsible for ensuring there has been a recent
+         * successful `pollState()` call before changing any settings and calling this method.
+         * On a successful call, the existing pending command will be cleared, and `pollState()` will be called to
+         * pick up the new state changes from the MCU.
+         *
+         * @return true on success, false on errors (including those from the `pollState()` call)
+         */
+        bool applySettings();
+#endif
+        /**
+         * Sends a complete, checksummed state command, such as one precompiled with `command::Scene`, instead of
+         * building one from the pending command. Any pending command is cleared, and `pollState()` is called to pick
+         * up the new state, as with `applySettings()`.
+         *
+         * @param frame the command bytes, in RAM or memory-mapped flash
+         * @return true on success, false on errors (including those from the `pollState()` call)
+         */
+        bool sendFrame(const uint8_t frame[STATE_COMMAND_SIZE]);
+        /**
+         * Like `sendFrame()`, for a command stored with `PROGMEM` on boards where flash is not memory-mapped.
+         * The command is only copied to the stack while it is sent.
+         */
+        bool sendFrame_P(const uint8_t *frame);
+        /**
+         * Sets how long to wait for each byte of a response from the MCU before giving up, by setting the
+         * serial connection's timeout. A unit that does not respond at all costs one timeout per operation.
+         */
+        void setResponseTimeout(uint32_t timeout_ms);
+
+    private:
+        Stream *m_serial = nullptr;
+#endif
+    };
+
+    /**
+     * Like `PioneerWYT`, but talks to the MCU through a transport chosen at compile time (see `wyt_transport.h`), so
+     * the byte path is inlined for each target, and can run off-device with `PosixFdTransport` or
+     * `LoopbackTransport`.
+     *
+     * @tparam Transport the transport class; it is held by value, so it should be cheap to copy
+     */
+    template <typename Transport>
+    class BasicPioneerWYT : public PioneerWYTBase
+    {
+    public:
+        explicit BasicPioneerWYT(const Transport &transport) : m_transport(transport) {}
+        BasicPioneerWYT(const Transport &transport, StateStore &store)
+            : PioneerWYTBase(store), m_transport(transport)
+        {
+        }
+
+        /** See `PioneerWYT::pollState()` */
+        bool pollState() { return pollStateWith(m_transport); }
+#ifndef PIONEER_UART_READ_ONLY
+        /** See `PioneerWYT::applySettings()` */
+        bool applySettings() { return applySettingsWith(m_transport); }
+#endif
+        /** See `PioneerWYT::sendFrame()` */
+        bool sendFrame(const uint8_t frame[STATE_COMMAND_SIZE]) { return sendFrameWith(m_transport, frame); }
+#ifdef USE_ARDUINO
+        /** See `PioneerWYT::sendFrame_P()` */
+        bool sendFrame_P(const uint8_t *frame)
+        {
+            uint8_t bytes[STATE_COMMAND_SIZE];
+            memcpy_P(bytes, frame, STATE_COMMAND_SIZE);
+            return sendFrameWith(m_transport, bytes);
+        }
+#endif
+        /** See `PioneerWYT::setResponseTimeout()`; needs a transport with `setTimeout()`. */
+        void setResponseTimeout(uint32_t timeout_ms) { m_transport.setTimeout(timeout_ms); }
+        /** Returns the transport, e.g. to queue responses on a `LoopbackTransport`. */
+        Transport &getTransport() { return m_transport; }
+
+    private:
+        Transport m_transport;
     };
 
 }
@@ -0,0 +1,42 @@
+#ifndef __PIONEER_UART_CONFIG_H__
+#define __PIONEER_UART_CONFIG_H__
+
+/**
+ * Compile-time feature selection, for boards where flash and RAM are tight. Each option is off unless defined,
+ * either by uncommenting it here (Arduino IDE) or with a build flag such as `-DPIONEER_UART_READ_ONLY`
+ * (PlatformIO `build_flags`). The options must be the same for the library and the sketch.
+ *
+ * `extras/footprint/footprint.sh` reports the flash and RAM used by each combination.
+ */
+
+/**
+ * Telemetry only: leaves out the `set*` methods, the pending command and `applySettings()`, so the unit can be
+ * watched but not changed. Fixed frames can still be sent with `sendFrame()`.
+ */
+// #define PIONEER_UART_READ_ONLY
+
+/**
+ * Keeps only the setters for power, mode, fan speed and temperature, leaving out eco, display, strong, health,
+ * mute, sleep and louver settings.
+ */
+// #define PIONEER_UART_BASIC_SETTERS
+
+/**
+ * Temperatures are `int16_t` tenths of a degree instead of `float`, so that no floating point code is linked.
+ * Use `WYT_DEGREES_C()` to write temperatures that work either way.
+ */
+// #define PIONEER_UART_FIXED_POINT
+
+/**
+ * Leaves out sanity checks: the range check when setting a temperature, and the header check on responses read
+ * from the unit.
+ */
+// #define PIONEER_UART_NO_VALIDATION
+
+/**
+ * Records every frame sent and received to a `WireTracer` set with `setTracer()` (see `wire_trace.h`). This adds a
+ * member to `PioneerWYT`, so like the options above it changes the class layout.
+ */
+// #define PIONEER_UART_TRACE
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef __RECONCILER_H__
+#define __RECONCILER_H__
+
+#include <stdint.h>
+#include "pioneer_uart.h"
+
+#define RECONCILER_DEFAULT_MIN_INTERVAL_MS 30000UL
+#define RECONCILER_DEFAULT_OVERRIDE_HOLD_MS 3600000UL
+
+// Reconciling needs to change settings on the unit
+#ifndef PIONEER_UART_READ_ONLY
+namespace pioneer_uart
+{
+    /** Settings that can be part of a `DesiredState`, as bits of `DesiredState::getFields()` */
+    enum DesiredField : uint16_t
+    {
+        DesiredPower = 1 << 0,
+        DesiredEco = 1 << 1,
+        DesiredDisplay = 1 << 2,
+        DesiredStrong = 1 << 3,
+        DesiredHealth = 1 << 4,
+        DesiredMute = 1 << 5,
+        DesiredMode = 1 << 6,
+        DesiredFanSpeed = 1 << 7,
+        DesiredTemperature = 1 << 8,
+        DesiredSleep = 1 << 9,
+        DesiredUpDownFlow = 1 << 10,
+        DesiredLeftRightFlow = 1 << 11,
+    };
+
+#ifdef PIONEER_UART_BASIC_SETTERS
+/** Only the basic settings can be changed on the unit in this configuration, so only they are enforced */
+#define DESIRED_SUPPORTED_FIELDS (DesiredPower | DesiredMode | DesiredFanSpeed | DesiredTemperature)
+#else
+#define DESIRED_SUPPORTED_FIELDS 0x0fff
+#endif
+
+    /**
+     * The settings automation wants a unit to have. Only the settings that have been set are enforced; anything else
+     * is left however the unit (or its remote) has it.
+     */
+    class DesiredState
+    {
+    public:
+        DesiredState();
+
+        void setPowerOn(bool power);
+        void setEco(bool eco);
+        void setDisplayOn(bool display);
+        void setStrong(bool strong);
+        void setHealth(bool health);
+        void setMute(bool mute);
+        void setMode(OpMode mode);
+        void setChosenFanSpeed(FanSpeed speed);
+        /** Sets the desired temperature, which is rounded down to the unit's 0.5 °C resolution. */
+        void setChosenTemperature(DegreesC temperature);
+        void setSleepMode(SleepMode sleep);
+        void setUpDownFlow(UpDownFlow flow);
+        void setLeftRightFlow(LeftRightFlow flow);
+        /** Stops enforcing the given `DesiredField` bits. */
+        void clear(uint16_t fields);
+
+        /** Returns the `DesiredField` bits that have been set. */
+        uint16_t getFields() const { return m_fields; }
+        /** Returns the `DesiredField` bits of settings where `state` differs from this. */
+        uint16_t differences(const WytResponse &state) const;
+        /**
+         * Adds the settings that differ from the unit's current state to its pending command, which is first cleared
+         * so that it is freshly seeded from the unit's state.
+         *
+         * @return the `DesiredField` bits that were changed
+         */
+        uint16_t stageOn(PioneerWYTBase &unit) const;
+
+    private:
+        uint16_t m_fields;
+        bool m_power;
+        bool m_eco;
+        bool m_display;
+        bool m_strong;
+        bool m_health;
+        bool m_mute;
+        OpMode m_mode;
+        FanSpeed m_fan_speed;
+        /** In half degrees C */
+        uint8_t m_temperature_half;
+        SleepMode m_sleep;
+        UpDownFlow m_up_down_flow;
+        LeftRightFlow m_left_right_flow;
+    };
+
+    enum class OverridePolicy : uint8_t
+    {
+        /** Always put the unit back to the desired state */
+        Enforce,
+        /** When someone changes a desired setting on the unit (e.g. with the remote), leave it alone for a while */
+        RespectManual,
+    };
+
+    enum class ReconcileResult : uint8_t
+    {
+        /** The unit has not been polled yet, so nothing can be compared */
+        NoState,
+        /** The unit already matches the desired state */
+        InSync,
+        /** The unit differs, but a command was sent too recently to send another */
+        RateLimited,
+        /** The unit differs because of a manual change that is being respected */
+        Overridden,
+        /** The unit differs, and a command to fix it is pending on the unit */
+        Staged,
+        /** The unit differed, and a command to fix it was sent */
+        Applied,
+        /** The unit differed, but sending a command to fix it failed */
+        Failed,
+    };
+
+    /**
+     * Keeps a unit in a desired state while only sending commands when it has actually drifted, rather than re-sending
+     * the full state every cycle. Call `reconcile()` after each poll of the unit.
+     */
+    class Reconciler
+    {
+    public:
+        /**
+         * @param policy what to do about settings changed by hand
+         * @param min_interval_ms shortest time between commands sent to the unit
+         * @param override_hold_ms with `OverridePolicy::RespectManual`, how long to leave a manual change alone
+         */
+        explicit Reconciler(OverridePolicy policy = OverridePolicy::Enforce,
+                            uint32_t min_interval_ms = RECONCILER_DEFAULT_MIN_INTERVAL_MS,
+                            uint32_t override_hold_ms = RECONCILER_DEFAULT_OVERRIDE_HOLD_MS);
+
+        /** Replaces the desired state, which also ends any manual override being respected. */
+        void setDesired(const DesiredState &desired);
+        const DesiredState &getDesired() const { return m_desired; }
+        /** Returns whether a manual change is currently being respected. */
+        bool isOverridden(uint32_t now_ms) const;
+
+        /**
+         * Compares the unit's state with the desired state and, if a command should be sent to fix it, stages that
+         * command as the unit's pending command, to be sent by the caller (e.g. with `applySettings()`).
+         *
+         * @param now_ms the current time, e.g. from `millis()`
+         * @return `ReconcileResult::Staged` if a command is pending and should be sent
+         */
+        ReconcileResult stage(PioneerWYTBase &unit, uint32_t now_ms);
+
+        /**
+         * Like `stage()`, but also sends the command with the unit's `applySettings()`.
+         *
+         * @tparam Unit `PioneerWYT` on Arduino, or any `BasicPioneerWYT`
+         */
+        template <typename Unit>
+        ReconcileResult reconcile(Unit &unit, uint32_t now_ms)
+        {
+            ReconcileResult result = stage(unit, now_ms);
+            if (result != ReconcileResult::Staged)
+            {
+                return result;
+            }
+            return unit.applySettings() ? ReconcileResult::Applied : ReconcileResult::Failed;
+        }
+
+    private:
+        DesiredState m_desired;
+        OverridePolicy m_policy;
+        uint32_t m_min_interval_ms;
+        uint32_t m_override_hold_ms;
+        uint32_t m_last_command_ms;
+        uint32_t m_override_since_ms;
+        bool m_has_commanded;
+        bool m_in_sync;
+        bool m_overridden;
+    };
+}
+#endif
+#endif
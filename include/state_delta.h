@@ -0,0 +1,75 @@
+#ifndef __STATE_DELTA_H__
+#define __STATE_DELTA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wyt_response.h"
+
+#define DELTA_KEYFRAME_TAG 0x4b
+#define DELTA_FRAME_TAG 0x44
+/** Largest encoded frame: tag, 5-byte varint timestamp and a full state */
+#define DELTA_MAX_ENCODED_SIZE (1 + 5 + RESPONSE_SIZE)
+#define DELTA_DEFAULT_KEYFRAME_INTERVAL 64
+
+namespace pioneer_uart
+{
+    /**
+     * Compresses a stream of states from a single unit for storage or transmission over slow links.
+     * Consecutive states usually differ in only a few bytes, so most frames are encoded as the XOR of the
+     * changed bytes against the previous state, with a full keyframe every so often to bound how far a
+     * decoder has to go back after a lost frame.
+     *
+     * Keyframes are the tag `K` (0x4b), the timestamp as an unsigned LEB128 varint, then the raw state.
+     * Delta frames are the tag `D` (0x44), the time since the previous frame as a varint, a byte with one
+     * bit set for each 8-byte group of the state containing changes, one byte for each such group with
+     * one bit set for each changed byte in it, then the XOR of each changed byte with its previous value.
+     */
+    class DeltaEncoder
+    {
+    public:
+        /** @param keyframe_interval emit a keyframe at least once every this many frames */
+        explicit DeltaEncoder(uint16_t keyframe_interval = DELTA_DEFAULT_KEYFRAME_INTERVAL);
+        /**
+         * Encodes the next state of the unit.
+         *
+         * @param timestamp time the state was read, in any unit, as long as it is consistent for the stream
+         * @param out receives the encoded frame
+         * @param capacity size of `out`; `DELTA_MAX_ENCODED_SIZE` always suffices
+         * @return the number of bytes written to `out`, or 0 if it was too small
+         */
+        size_t encode(const response::WytResponse &state, uint32_t timestamp, uint8_t *out, size_t capacity);
+        /** Makes the next frame a keyframe, e.g. after the receiver has lost frames. */
+        void reset();
+
+    private:
+        response::WytResponse m_previous;
+        uint32_t m_previous_timestamp;
+        uint16_t m_keyframe_interval;
+        uint16_t m_since_keyframe;
+        bool m_has_previous;
+    };
+
+    /** Reconstructs states from frames produced by a `DeltaEncoder`. */
+    class DeltaDecoder
+    {
+    public:
+        DeltaDecoder();
+        /**
+         * Decodes the next frame from `in`.
+         *
+         * @param state receives the decoded state
+         * @param timestamp receives the decoded timestamp
+         * @return the number of bytes consumed from `in`, or 0 if the frame is truncated, malformed, or is a
+         * delta frame without a preceding keyframe
+         */
+        size_t decode(const uint8_t *in, size_t length, response::WytResponse &state, uint32_t &timestamp);
+        /** Discards the previous state, so the next frame must be a keyframe. */
+        void reset();
+
+    private:
+        response::WytResponse m_previous;
+        uint32_t m_previous_timestamp;
+        bool m_has_previous;
+    };
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef __STATE_SERIALIZER_H__
+#define __STATE_SERIALIZER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wyt_response.h"
+
+namespace pioneer_uart
+{
+    namespace serializer
+    {
+        /**
+         * Writes the decoded state as a JSON object into `out`, without using the heap.
+         * Field names match the `PioneerWYT` getters in snake case (e.g. `indoor_temperature`), enumerations are
+         * written as lower case strings, and temperatures in degrees C.
+         *
+         * @param previous if not `nullptr`, only fields whose decoded value differs from this state are written
+         * @param capacity size of `out`, including space for the terminating `\0`
+         * @return the length of the JSON written (excluding the `\0`), or 0 if it did not fit
+         */
+        size_t to_json(const response::WytResponse &state, char *out, size_t capacity,
+                       const response::WytResponse *previous = nullptr);
+
+        /**
+         * Writes the decoded state as a CBOR map into `out`, without using the heap.
+         * Keys and values are the same as for `to_json`; temperatures are written as single-precision floats.
+         *
+         * @param previous if not `nullptr`, only fields whose decoded value differs from this state are written
+         * @param capacity size of `out`
+         * @return the number of bytes written, or 0 if they did not fit
+         */
+        size_t to_cbor(const response::WytResponse &state, uint8_t *out, size_t capacity,
+                       const response::WytResponse *previous = nullptr);
+
+        /**
+         * Looks up an enumeration value from the name `to_json` writes for it, e.g. `cool` for `mode`, for parsing
+         * commands that use the same names.
+         *
+         * @param key the field's key, e.g. `mode`
+         * @param name the value's name, which need not be `\0` terminated
+         * @param length length of `name`
+         * @param value set to the raw enumeration value if found
+         * @return false if `key` is not an enumeration field, or `name` is not one of its values
+         */
+        bool from_name(const char *key, const char *name, size_t length, uint8_t &value);
+    }
+}
+#endif
@@ -0,0 +1,95 @@
+#ifndef __STATE_STORE_H__
+#define __STATE_STORE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wyt_response.h"
+
+#define STATE_RECORD_MAGIC 0x57
+#define STATE_RECORD_VERSION 1
+#define STATE_RECORD_SIZE (RESPONSE_SIZE + 3)
+
+namespace pioneer_uart
+{
+    /** A saved copy of the last good unit state, as laid out in non-volatile storage. */
+    union StateRecord
+    {
+        struct
+        {
+            // 00
+            uint8_t magic;
+            // 01
+            uint8_t version;
+            // 02..3e
+            uint8_t state[RESPONSE_SIZE];
+            // 3f
+            uint8_t checksum;
+        } __attribute__((packed));
+        uint8_t bytes[STATE_RECORD_SIZE];
+    };
+
+    /**
+     * Non-volatile storage for the last known good state of a unit, so a `PioneerWYT` can be restored
+     * with usable state after a reset instead of waiting for its first successful poll.
+     * Subclasses only need to move raw record bytes in and out of their storage medium; versioning and
+     * integrity checks are handled here.
+     */
+    class StateStore
+    {
+    public:
+        virtual ~StateStore() {}
+        /**
+         * Reads the saved state, if there is one.
+         *
+         * @return false if nothing was saved, or the saved record is corrupt or from an older version
+         */
+        bool load(response::WytResponse &state);
+        /**
+         * Saves the given state, replacing any previously saved one.
+         *
+         * @return true on success, false on errors
+         */
+        bool save(const response::WytResponse &state);
+
+    protected:
+        virtual bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) = 0;
+        virtual bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) = 0;
+    };
+
+#ifdef USE_ARDUINO
+    /**
+     * Stores the state record in EEPROM (emulated in flash or NVS on ESP boards).
+     * On ESP boards the caller must call `EEPROM.begin()` with a size of at least `offset + STATE_RECORD_SIZE`
+     * before constructing any `PioneerWYT` that uses this store.
+     */
+    class EepromStateStore : public StateStore
+    {
+    public:
+        /** @param offset first EEPROM address of the `STATE_RECORD_SIZE` bytes reserved for this unit */
+        explicit EepromStateStore(int offset = 0);
+
+    protected:
+        bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) override;
+        bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) override;
+
+    private:
+        int m_offset;
+    };
+#elif !defined(__AVR__)
+    /** Stores the state record in a file, for hosts with a filesystem. */
+    class FileStateStore : public StateStore
+    {
+    public:
+        /** @param path file to keep the record in; it is created on the first save */
+        explicit FileStateStore(const char *path);
+
+    protected:
+        bool readRecord(uint8_t bytes[STATE_RECORD_SIZE]) override;
+        bool writeRecord(const uint8_t bytes[STATE_RECORD_SIZE]) override;
+
+    private:
+        const char *m_path;
+    };
+#endif
+}
+#endif
@@ -0,0 +1,142 @@
+#ifndef __THERMOSTAT_H__
+#define __THERMOSTAT_H__
+
+#include <stdint.h>
+#include "pioneer_uart.h"
+
+#define THERMOSTAT_DEFAULT_HYSTERESIS WYT_DEGREES_C(0.2)
+#define THERMOSTAT_DEFAULT_BUDGET_BURST 3
+#define THERMOSTAT_DEFAULT_BUDGET_INTERVAL_MS 900000UL
+#define THERMOSTAT_DEFAULT_MAX_SAMPLE_AGE_MS 600000UL
+/** Lowest and highest setpoints sent to the unit, in half degrees C, as its remote allows */
+#define THERMOSTAT_MIN_SETPOINT_HALF 32
+#define THERMOSTAT_MAX_SETPOINT_HALF 60
+/** Weight of each new reading in the averaged sensor bias is 1 / 2^this */
+#define THERMOSTAT_BIAS_SMOOTHING_SHIFT 3
+
+// The thermostat works by changing the unit's setpoint
+#ifndef PIONEER_UART_READ_ONLY
+namespace pioneer_uart
+{
+    enum class ThermostatResult : uint8_t
+    {
+        /** The unit has not been polled yet */
+        NoState,
+        /** There is no external reading, or it is older than the maximum sample age */
+        NoSample,
+        /** The unit is off, or in a mode without a setpoint, so it is left alone */
+        Idle,
+        /** The unit's setpoint is within the hysteresis of the one wanted, or the change cannot be expressed */
+        Holding,
+        /** The setpoint should change, but the command budget is spent */
+        OutOfBudget,
+        /** A setpoint change is pending on the unit */
+        Staged,
+        /** A setpoint change was sent */
+        Applied,
+        /** Sending a setpoint change failed, so it was not counted against the budget */
+        Failed,
+    };
+
+    /**
+     * Holds a room at a target temperature measured by an external sensor, by moving the unit's own setpoint.
+     *
+     * The unit regulates on its indoor sensor, which sits next to the evaporator and reads off from the room. The
+     * difference between it and the external reading (the bias) is averaged over time, and the unit is given the
+     * setpoint `target + bias`, so that it stops where the room reaches the target. Power and mode are never
+     * changed; the thermostat only acts while the unit is on in heat, cool or auto mode.
+     *
+     * To keep bus traffic down, the setpoint is only moved in the unit's 0.5 °C steps, only once the wanted
+     * setpoint is further than `hysteresis` past the midpoint to the next step, and only while the command budget
+     * lasts: a bucket of `budget_burst` commands, refilled by one every `budget_interval_ms`.
+     *
+     * The bias is averaged over external readings, each taken once, so it is the same however often the unit is
+     * polled. The setpoint is staged on top of whatever is already pending on the unit (e.g. from an `MqttBridge`),
+     * and sent with it; only a pending temperature is replaced.
+     *
+     * Call `setExternalTemperature()` whenever the sensor reports, and `update()` after each poll of the unit. All
+     * times are from a free-running millisecond clock such as `millis()`, and may wrap.
+     */
+    class Thermostat
+    {
+    public:
+        /**
+         * @param target room temperature to hold
+         * @param hysteresis how far past the midpoint between two steps the wanted setpoint must be to move
+         * @param budget_burst most commands that can be sent back to back
+         * @param budget_interval_ms time to earn back one command
+         * @param max_sample_age_ms how long an external reading is used for
+         */
+        explicit Thermostat(DegreesC target, DegreesC hysteresis = THERMOSTAT_DEFAULT_HYSTERESIS,
+                            uint8_t budget_burst = THERMOSTAT_DEFAULT_BUDGET_BURST,
+                            uint32_t budget_interval_ms = THERMOSTAT_DEFAULT_BUDGET_INTERVAL_MS,
+                            uint32_t max_sample_age_ms = THERMOSTAT_DEFAULT_MAX_SAMPLE_AGE_MS);
+
+        void setTarget(DegreesC target);
+        DegreesC getTarget() const;
+        /** Records a reading of the room temperature from the external sensor. */
+        void setExternalTemperature(DegreesC temperature, uint32_t now_ms);
+
+        /**
+         * Returns the averaged amount by which the unit's indoor sensor reads above the external one, over the external
+         * readings so far.
+         */
+        DegreesC getBias() const;
+        /** Returns the setpoint last wanted for the unit, before rounding to its 0.5 °C steps. */
+        DegreesC getWantedSetpoint() const;
+        /** Returns how many commands can be sent now. */
+        uint8_t getBudget(uint32_t now_ms);
+
+        /**
+         * Averages a new external reading, if there is one, into the bias against the unit's state and, if the unit's
+         * setpoint should move, adds the new one to the unit's pending command, to be sent by the caller (e.g. with
+         * `applySettings()`). A staged command is taken from the budget.
+         *
+         * @return `ThermostatResult::Staged` if a command is pending and should be sent
+         */
+        ThermostatResult stage(PioneerWYTBase &unit, uint32_t now_ms);
+
+        /**
+         * Like `stage()`, but also sends the command with the unit's `applySettings()`, and gives the command back to
+         * the budget if that fails.
+         *
+         * @tparam Unit `PioneerWYT` on Arduino, or any `BasicPioneerWYT`
+         */
+        template <typename Unit>
+        ThermostatResult update(Unit &unit, uint32_t now_ms)
+        {
+            ThermostatResult result = stage(unit, now_ms);
+            if (result != ThermostatResult::Staged)
+            {
+                return result;
+            }
+            if (unit.applySettings())
+            {
+                return ThermostatResult::Applied;
+            }
+            ++m_budget;
+            return ThermostatResult::Failed;
+        }
+
+    private:
+        /** All temperatures are kept in tenths of a degree C, so this works the same without floating point */
+        int16_t m_target_tenths;
+        int16_t m_hysteresis_tenths;
+        int16_t m_external_tenths;
+        int16_t m_wanted_tenths;
+        /** The averaged bias, in tenths scaled by 2^THERMOSTAT_BIAS_SMOOTHING_SHIFT */
+        int32_t m_bias_scaled;
+        uint32_t m_budget_interval_ms;
+        uint32_t m_max_sample_age_ms;
+        uint32_t m_sample_ms;
+        uint32_t m_refill_ms;
+        uint8_t m_budget_burst;
+        uint8_t m_budget;
+        bool m_has_sample;
+        /** Whether the external reading has not been averaged into the bias yet */
+        bool m_has_new_sample;
+        bool m_has_bias;
+    };
+}
+#endif
+#endif
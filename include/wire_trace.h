@@ -0,0 +1,79 @@
+#ifndef __WIRE_TRACE_H__
+#define __WIRE_TRACE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_RECORD_HEADER_SIZE 6
+
+namespace pioneer_uart
+{
+    enum class TraceDirection : uint8_t
+    {
+        Sent = 0x01,
+        Received = 0x02,
+    };
+
+    /**
+     * Records every frame sent to or received from the WYT MCU into a caller-provided ring buffer, for
+     * diagnosing protocol problems without the timing disturbance of printing as it happens.
+     * When the buffer fills, the oldest records are dropped whole, so a dump always parses cleanly.
+     *
+     * Each record is laid out as:
+     *  - 00..03 timestamp, in microseconds, little-endian (wraps like `micros()`)
+     *  - 04 `TraceDirection`
+     *  - 05 payload length `n`
+     *  - 06..(06 + n - 1) payload bytes, exactly as they went over the wire
+     *
+     * Tracing only happens when the library is built with `PIONEER_UART_TRACE` defined; otherwise the hooks
+     * in `PioneerWYT` compile to nothing.
+     */
+    class WireTracer
+    {
+    public:
+        /**
+         * @param buffer storage for trace records, which must outlive the tracer
+         * @param size size of `buffer`; records larger than this are skipped
+         */
+        WireTracer(uint8_t *buffer, size_t size);
+        /** Appends a record for `length` bytes that just went over the wire in the given direction. */
+        void record(TraceDirection direction, const uint8_t *bytes, uint8_t length);
+        /**
+         * Copies the held records, oldest first, into `out`. Only whole records are copied.
+         *
+         * @return the number of bytes written to `out`
+         */
+        size_t dump(uint8_t *out, size_t size) const;
+        /** Returns the number of bytes of records currently held. */
+        size_t used() const;
+        /** Discards all held records. */
+        void clear();
+
+    private:
+        uint8_t *m_buffer;
+        size_t m_size;
+        size_t m_head;
+        size_t m_used;
+
+        void put(size_t position, const uint8_t *bytes, size_t length);
+        uint8_t at(size_t offset) const;
+    };
+}
+
+#ifdef PIONEER_UART_TRACE
+#define WYT_TRACE(tracer, direction, bytes, length)     \
+    do                                                  \
+    {                                                   \
+        if (tracer)                                     \
+        {                                               \
+            (tracer)->record(direction, bytes, length); \
+        }                                               \
+    } while (0)
+#else
+#define WYT_TRACE(tracer, direction, bytes, length) \
+    do                                              \
+    {                                               \
+    } while (0)
+#endif
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <assert.h>
+#include "pioneer_uart_config.h"
 #include "wyt_response.h"
 #define HEADER_SIZE 5
 #define STATE_COMMAND_SIZE 35
@@ -165,15 +166,19 @@ namespace pioneer_uart
             uint8_t bytes[STATE_COMMAND_SIZE];
         } WytSetStateCommand;
 
-        inline void set_chosen_temperature(WytSetStateCommand &command, const float temp_c)
+        /** Sets the temperature, in half degrees C, for code that avoids floating point. */
+        inline void set_chosen_temperature_half(WytSetStateCommand &command, const uint8_t temp_half)
         {
-            assert(temp_c >= 10.0 && temp_c <= 30.0);
+#ifndef PIONEER_UART_NO_VALIDATION
+            assert(temp_half >= 20 && temp_half <= 60);
+#endif
 
-            uint8_t temp_double = static_cast<uint8_t>(temp_c * 2);
-            uint8_t temp_whole = temp_double / 2;
-            bool temp_half = temp_double % 2;
-            command.set_temperature_whole = temp_whole + 0x6f;
-            command.set_temperature_half = temp_half;
+            command.set_temperature_whole = temp_half / 2 + 0x6f;
+            command.set_temperature_half = temp_half % 2;
+        }
+        inline void set_chosen_temperature(WytSetStateCommand &command, const float temp_c)
+        {
+            set_chosen_temperature_half(command, static_cast<uint8_t>(temp_c * 2));
         }
         uint8_t checksum(const WytSetStateCommand &command);
         void set_checksum(WytSetStateCommand *command);
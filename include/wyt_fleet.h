@@ -0,0 +1,262 @@
+#ifndef __WYT_FLEET_H__
+#define __WYT_FLEET_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include "wyt_response.h"
+
+namespace pioneer_uart
+{
+    /** Bits of the per-unit flags column in a `FleetStore`. */
+    enum FleetFlag : uint16_t
+    {
+        FleetValid = 1 << 0,
+        FleetPower = 1 << 1,
+        FleetEco = 1 << 2,
+        FleetDisplay = 1 << 3,
+        FleetStrong = 1 << 4,
+        FleetHealth = 1 << 5,
+        FleetMute = 1 << 6,
+        FleetVerticalFlow = 1 << 7,
+        FleetHorizontalFlow = 1 << 8,
+        FleetFourWayValve = 1 << 9,
+        FleetAntifreeze = 1 << 10,
+        FleetHeatMode = 1 << 11,
+    };
+
+    /**
+     * Decoded state for a large number of units, stored column by column so that queries across the whole
+     * fleet scan small contiguous arrays instead of visiting a `PioneerWYT` (and its padding) per unit.
+     * Only the fields with known meanings are kept, at 17 bytes per unit. Temperatures are kept in
+     * their raw encodings, and query thresholds are converted to that encoding once per query.
+     *
+     * @tparam Capacity maximum number of units; units are addressed by index `0..Capacity - 1`
+     */
+    template <uint16_t Capacity>
+    class FleetStore
+    {
+    public:
+        FleetStore()
+        {
+            clear();
+        }
+
+        /** Forgets the state of all units. */
+        void clear()
+        {
+            for (uint16_t unit = 0; unit < Capacity; ++unit)
+            {
+                m_flags[unit] = 0;
+            }
+        }
+
+        /** Replaces the stored state for `unit` with a newly received state. */
+        void update(uint16_t unit, const response::WytResponse &state)
+        {
+            if (unit >= Capacity)
+            {
+                return;
+            }
+            m_flags[unit] = FleetValid |
+                            (state.power ? FleetPower : 0) |
+                            (state.eco ? FleetEco : 0) |
+                            (state.display ? FleetDisplay : 0) |
+                            (state.strong ? FleetStrong : 0) |
+                            (state.health ? FleetHealth : 0) |
+                            (state.mute ? FleetMute : 0) |
+                            (state.vertical_flow ? FleetVerticalFlow : 0) |
+                            (state.horizontal_flow ? FleetHorizontalFlow : 0) |
+                            (state.four_way_valve_on ? FleetFourWayValve : 0) |
+                            (state.antifreeze ? FleetAntifreeze : 0) |
+                            (state.heat_mode ? FleetHeatMode : 0);
+            m_mode[unit] = static_cast<uint8_t>(state.mode);
+            m_fan_sleep[unit] = static_cast<uint8_t>(state.fan_speed) | (static_cast<uint8_t>(state.sleep) << 3);
+            m_chosen_temperature_half[unit] = response::get_chosen_temperature_half(state);
+            m_indoor_temp[unit] = state.indoor_temp_base;
+            m_indoor_heat_exchanger_temp[unit] = state.indoor_heat_exchanger_temp;
+            m_outdoor_temp[unit] = state.outdoor_temp;
+            m_condenser_coil_temp[unit] = state.condenser_coil_temp;
+            m_compressor_discharge_temp[unit] = state.compressor_discharge_temp;
+            m_compressor_frequency[unit] = state.compressor_frequency;
+            m_indoor_fan_speed[unit] = static_cast<uint8_t>(state.indoor_fan_speed);
+            m_outdoor_fan_speed[unit] = state.outdoor_fan_speed;
+            m_supply_voltage[unit] = state.supply_voltage;
+            m_current_used_amps[unit] = state.current_used_amps;
+            m_up_down_flow[unit] = static_cast<uint8_t>(state.up_down_flow);
+            m_left_right_flow[unit] = static_cast<uint8_t>(state.left_right_flow);
+        }
+
+        /** Marks `unit` as having no known state, so it is excluded from queries. */
+        void invalidate(uint16_t unit)
+        {
+            if (unit < Capacity)
+            {
+                m_flags[unit] = 0;
+            }
+        }
+
+        bool isValid(uint16_t unit) const { return m_flags[checked(unit)] & FleetValid; }
+        /** Returns the `FleetFlag` bits for `unit`. */
+        uint16_t getFlags(uint16_t unit) const { return m_flags[checked(unit)]; }
+        response::OpMode getMode(uint16_t unit) const { return static_cast<response::OpMode>(m_mode[checked(unit)]); }
+        response::FanSpeed getChosenFanSpeed(uint16_t unit) const { return static_cast<response::FanSpeed>(m_fan_sleep[checked(unit)] & 0x07); }
+        response::SleepMode getSleepMode(uint16_t unit) const { return static_cast<response::SleepMode>(m_fan_sleep[checked(unit)] >> 3); }
+        float getChosenTemperature(uint16_t unit) const { return m_chosen_temperature_half[checked(unit)] * 0.5f; }
+        float getIndoorTemperature(uint16_t unit) const { return response::indoor_sensor_degrees_c(m_indoor_temp[checked(unit)]); }
+        float getIndoorHeatExchangerTemperature(uint16_t unit) const { return response::indoor_sensor_degrees_c(m_indoor_heat_exchanger_temp[checked(unit)]); }
+        float getOutdoorTemperature(uint16_t unit) const { return m_outdoor_temp[checked(unit)]; }
+        float getCondenserCoilTemperature(uint16_t unit) const { return m_condenser_coil_temp[checked(unit)]; }
+        float getCompressorDischargeTemperature(uint16_t unit) const { return m_compressor_discharge_temp[checked(unit)]; }
+        uint8_t getCompressorFrequency(uint16_t unit) const { return m_compressor_frequency[checked(unit)]; }
+        response::IndoorFanSpeed getIndoorFanSpeed(uint16_t unit) const { return static_cast<response::IndoorFanSpeed>(m_indoor_fan_speed[checked(unit)]); }
+        uint8_t getOutdoorFanSpeed(uint16_t unit) const { return m_outdoor_fan_speed[checked(unit)]; }
+        uint8_t getSupplyVoltage(uint16_t unit) const { return m_supply_voltage[checked(unit)]; }
+        uint8_t getCurrentUsedAmps(uint16_t unit) const { return m_current_used_amps[checked(unit)]; }
+        response::UpDownFlow getUpDownFlow(uint16_t unit) const { return static_cast<response::UpDownFlow>(m_up_down_flow[checked(unit)]); }
+        response::LeftRightFlow getLeftRightFlow(uint16_t unit) const { return static_cast<response::LeftRightFlow>(m_left_right_flow[checked(unit)]); }
+
+        /**
+         * Finds powered-on units in `mode` whose indoor temperature is below `temperature`.
+         *
+         * @param out receives the matching unit indexes, in ascending order
+         * @param max_results size of `out`
+         * @return the number of matches written to `out`
+         */
+        size_t findIndoorBelow(response::OpMode mode, float temperature, uint16_t *out, size_t max_results) const
+        {
+            uint16_t limit = rawIndoorLimit(temperature);
+            uint8_t wanted_mode = static_cast<uint8_t>(mode);
+            size_t found = 0;
+            for (uint16_t unit = 0; unit < Capacity && found < max_results; ++unit)
+            {
+                if (m_mode[unit] == wanted_mode && m_indoor_temp[unit] < limit &&
+                    (m_flags[unit] & (FleetValid | FleetPower)) == (FleetValid | FleetPower))
+                {
+                    out[found++] = unit;
+                }
+            }
+            return found;
+        }
+
+        /**
+         * Finds powered-on units in `mode` whose indoor temperature is at or above `temperature`.
+         *
+         * @param out receives the matching unit indexes, in ascending order
+         * @param max_results size of `out`
+         * @return the number of matches written to `out`
+         */
+        size_t findIndoorAtOrAbove(response::OpMode mode, float temperature, uint16_t *out, size_t max_results) const
+        {
+            uint16_t limit = rawIndoorLimit(temperature);
+            uint8_t wanted_mode = static_cast<uint8_t>(mode);
+            size_t found = 0;
+            for (uint16_t unit = 0; unit < Capacity && found < max_results; ++unit)
+            {
+                if (m_mode[unit] == wanted_mode && m_indoor_temp[unit] >= limit &&
+                    (m_flags[unit] & (FleetValid | FleetPower)) == (FleetValid | FleetPower))
+                {
+                    out[found++] = unit;
+                }
+            }
+            return found;
+        }
+
+        /**
+         * Finds units whose `FleetFlag` bits in `mask` are exactly `value`, e.g. `(FleetValid | FleetPower, FleetValid)`
+         * for every unit known to be off.
+         *
+         * @param out receives the matching unit indexes, in ascending order
+         * @param max_results size of `out`
+         * @return the number of matches written to `out`
+         */
+        size_t findByFlags(uint16_t mask, uint16_t value, uint16_t *out, size_t max_results) const
+        {
+            size_t found = 0;
+            for (uint16_t unit = 0; unit < Capacity && found < max_results; ++unit)
+            {
+                if ((m_flags[unit] & mask) == value)
+                {
+                    out[found++] = unit;
+                }
+            }
+            return found;
+        }
+
+        /** Counts units whose `FleetFlag` bits in `mask` are exactly `value`. */
+        size_t countByFlags(uint16_t mask, uint16_t value) const
+        {
+            size_t count = 0;
+            for (uint16_t unit = 0; unit < Capacity; ++unit)
+            {
+                count += (m_flags[unit] & mask) == value;
+            }
+            return count;
+        }
+
+        /**
+         * Finds valid units with a compressor frequency at or above `frequency`.
+         *
+         * @param out receives the matching unit indexes, in ascending order
+         * @param max_results size of `out`
+         * @return the number of matches written to `out`
+         */
+        size_t findCompressorAtOrAbove(uint8_t frequency, uint16_t *out, size_t max_results) const
+        {
+            size_t found = 0;
+            for (uint16_t unit = 0; unit < Capacity && found < max_results; ++unit)
+            {
+                if (m_compressor_frequency[unit] >= frequency && (m_flags[unit] & FleetValid))
+                {
+                    out[found++] = unit;
+                }
+            }
+            return found;
+        }
+
+    private:
+        uint16_t m_flags[Capacity];
+        uint8_t m_mode[Capacity];
+        uint8_t m_fan_sleep[Capacity];
+        uint8_t m_chosen_temperature_half[Capacity];
+        uint8_t m_indoor_temp[Capacity];
+        uint8_t m_indoor_heat_exchanger_temp[Capacity];
+        uint8_t m_outdoor_temp[Capacity];
+        uint8_t m_condenser_coil_temp[Capacity];
+        uint8_t m_compressor_discharge_temp[Capacity];
+        uint8_t m_compressor_frequency[Capacity];
+        uint8_t m_indoor_fan_speed[Capacity];
+        uint8_t m_outdoor_fan_speed[Capacity];
+        uint8_t m_supply_voltage[Capacity];
+        uint8_t m_current_used_amps[Capacity];
+        uint8_t m_up_down_flow[Capacity];
+        uint8_t m_left_right_flow[Capacity];
+
+        /** Returns `unit`, checking in debug builds that it is in range for the per-unit getters. */
+        static uint16_t checked(uint16_t unit)
+        {
+            assert(unit < Capacity);
+            return unit;
+        }
+
+        /**
+         * Returns the lowest raw indoor reading that decodes to `temperature` or above (256 if none does), by
+         * inverting `indoor_sensor_decidegrees_c()` with `temperature` rounded to the nearest tenth.
+         */
+        static uint16_t rawIndoorLimit(float temperature)
+        {
+            float tenths = temperature * 10;
+            int32_t offset_tenths = static_cast<int32_t>(tenths < 0 ? tenths - 0.5f : tenths + 0.5f) + 115;
+            if (offset_tenths <= 0)
+            {
+                return 0;
+            }
+            if (offset_tenths > 0xff * 3)
+            {
+                return 0x100;
+            }
+            return (offset_tenths + 2) / 3;
+        }
+    };
+}
+#endif
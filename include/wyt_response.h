@@ -192,8 +192,42 @@ namespace pioneer_uart
             return 16 + state.set_temperature_whole + (state.set_temperature_half ? 0.5 : 0);
         }
 
+        /** Returns the temperature setting in half degrees C, for code that avoids floating point. */
+        inline uint8_t get_chosen_temperature_half(const WytResponse &state)
+        {
+            return (16 + state.set_temperature_whole) * 2 + state.set_temperature_half;
+        }
+
+        /** Converts a raw indoor or indoor heat exchanger temperature reading to degrees C. */
+        inline float indoor_sensor_degrees_c(const uint8_t raw)
+        {
+            return raw * 0.3 - 11.5;
+        }
+
+        /** Like `indoor_sensor_degrees_c`, but in tenths of a degree C. */
+        inline int16_t indoor_sensor_decidegrees_c(const uint8_t raw)
+        {
+            return raw * 3 - 115;
+        }
+
         WytResponse from_bytes(const uint8_t buffer[RESPONSE_SIZE]);
 
+        /** Returns the XOR of every byte of the response but the last, which the unit sends as the checksum. */
+        uint8_t checksum(const WytResponse &response);
+        /**
+         * Checks the header of a response read from the unit (magic, source bytes `01 00`, response type and length)
+         * and its checksum, to catch reads that are misaligned, corrupted, or are not responses at all.
+         */
+        bool is_valid(const WytResponse &response);
+
+        /**
+         * Compares only the user-settable fields of two states (those that `command::from_response` copies
+         * into a new command), ignoring sensor readings and unknown bytes.
+         *
+         * @return true if both states would produce the same state command
+         */
+        bool has_same_settings(const WytResponse &a, const WytResponse &b);
+
     }
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#ifndef __WYT_SCENE_H__
+#define __WYT_SCENE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "wyt_command.h"
+
+#define SCENE_MIN_TEMPERATURE_HALF 20
+#define SCENE_MAX_TEMPERATURE_HALF 60
+
+namespace pioneer_uart
+{
+    namespace command
+    {
+        /** The bytes of a complete, checksummed state command, ready to send with `PioneerWYT::sendFrame()`. */
+        struct SceneFrame
+        {
+            uint8_t bytes[STATE_COMMAND_SIZE];
+        };
+
+        /**
+         * Builds state commands for fixed scenes ("all off", "cool 24 auto fan", ...) entirely at compile time, so
+         * sending one needs no RAM and no computation. Start from `Scene()` and chain settings, then call `frame()`:
+         *
+         *     constexpr command::SceneFrame COOL_24 PROGMEM =
+         *         command::Scene().power(true).mode(command::OpMode::Cool).temperature(24).frame();
+         *
+         * Unlike commands seeded from the unit's state with `from_response`, every setting in a scene is fixed, so
+         * anything not chained takes the default shown in the constructor. Unknown bytes are zero, apart from the
+         * 0x80 that `from_response` also sets. Settings are laid out as in `WytSetStateCommand`.
+         */
+        class Scene
+        {
+        public:
+            constexpr Scene()
+                : Scene(false, OpMode::Auto, 48, FanSpeed::Auto, SleepMode::Off, false, false, true, false, false,
+                        UpDownFlow::Auto, LeftRightFlow::Auto)
+            {
+            }
+
+            constexpr Scene power(bool on) const
+            {
+                return Scene(on, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene mode(OpMode mode) const
+            {
+                return Scene(m_power, mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            /** Sets the temperature, rounded down to 0.5 °C and clamped to 10-30 °C. */
+            constexpr Scene temperature(float temp_c) const
+            {
+                return Scene(m_power, m_mode, clampTemperatureHalf(static_cast<int>(temp_c * 2)), m_fan_speed, m_sleep,
+                             m_eco, m_strong, m_display, m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene fanSpeed(FanSpeed speed) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene sleep(SleepMode sleep) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene eco(bool eco) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene strong(bool strong) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, strong, m_display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene display(bool display) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, display,
+                             m_health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene health(bool health) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             health, m_mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene mute(bool mute) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, mute, m_up_down_flow, m_left_right_flow);
+            }
+            constexpr Scene upDownFlow(UpDownFlow flow) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, flow, m_left_right_flow);
+            }
+            constexpr Scene leftRightFlow(LeftRightFlow flow) const
+            {
+                return Scene(m_power, m_mode, m_temperature_half, m_fan_speed, m_sleep, m_eco, m_strong, m_display,
+                             m_health, m_mute, m_up_down_flow, flow);
+            }
+
+            /** Returns byte `index` of the command, without the checksum. */
+            constexpr uint8_t byte(size_t index) const
+            {
+                return index == 0x00 ? 0xbb
+                     : index == 0x01 ? static_cast<uint8_t>(static_cast<uint16_t>(Source::Controller))
+                     : index == 0x02 ? static_cast<uint8_t>(static_cast<uint16_t>(Source::Controller) >> 8)
+                     : index == 0x03 ? static_cast<uint8_t>(Command::SetState)
+                     : index == 0x04 ? 0x1d
+                     : index == 0x07 ? static_cast<uint8_t>(m_eco | m_display << 1 | !m_mute << 2 | m_power << 5)
+                     : index == 0x08 ? static_cast<uint8_t>(m_mute | m_strong << 1 | m_health << 3 |
+                                                            static_cast<uint8_t>(m_mode) << 4)
+                     : index == 0x09 ? static_cast<uint8_t>(m_temperature_half / 2 + 0x6f)
+                     : index == 0x0a ? static_cast<uint8_t>(static_cast<uint8_t>(m_fan_speed) << 5)
+                     : index == 0x0b ? static_cast<uint8_t>((m_temperature_half % 2) << 5)
+                     : index == 0x0c ? 0x80
+                     : index == 0x13 ? static_cast<uint8_t>(m_sleep)
+                     : index == 0x20 ? static_cast<uint8_t>(m_up_down_flow)
+                     : index == 0x21 ? static_cast<uint8_t>(m_left_right_flow)
+                     : 0;
+            }
+
+            /** Returns the checksum of the command, as `checksum()` would compute it. */
+            constexpr uint8_t checksum(size_t from = 0) const
+            {
+                return from >= STATE_COMMAND_SIZE - 1 ? 0 : static_cast<uint8_t>(byte(from) ^ checksum(from + 1));
+            }
+
+            /** Returns the complete command. */
+            constexpr SceneFrame frame() const
+            {
+                return SceneFrame{{byte(0), byte(1), byte(2), byte(3), byte(4), byte(5), byte(6), byte(7),
+                                   byte(8), byte(9), byte(10), byte(11), byte(12), byte(13), byte(14), byte(15),
+                                   byte(16), byte(17), byte(18), byte(19), byte(20), byte(21), byte(22), byte(23),
+                                   byte(24), byte(25), byte(26), byte(27), byte(28), byte(29), byte(30), byte(31),
+                                   byte(32), byte(33), checksum()}};
+            }
+
+        private:
+            bool m_power;
+            OpMode m_mode;
+            /** In half degrees C */
+            uint8_t m_temperature_half;
+            FanSpeed m_fan_speed;
+            SleepMode m_sleep;
+            bool m_eco;
+            bool m_strong;
+            bool m_display;
+            bool m_health;
+            bool m_mute;
+            UpDownFlow m_up_down_flow;
+            LeftRightFlow m_left_right_flow;
+
+            constexpr Scene(bool power, OpMode mode, uint8_t temperature_half, FanSpeed fan_speed, SleepMode sleep,
+                            bool eco, bool strong, bool display, bool health, bool mute, UpDownFlow up_down_flow,
+                            LeftRightFlow left_right_flow)
+                : m_power(power), m_mode(mode), m_temperature_half(temperature_half), m_fan_speed(fan_speed),
+                  m_sleep(sleep), m_eco(eco), m_strong(strong), m_display(display), m_health(health), m_mute(mute),
+                  m_up_down_flow(up_down_flow), m_left_right_flow(left_right_flow)
+            {
+            }
+
+            static constexpr uint8_t clampTemperatureHalf(int temperature_half)
+            {
+                return temperature_half < SCENE_MIN_TEMPERATURE_HALF   ? SCENE_MIN_TEMPERATURE_HALF
+                       : temperature_half > SCENE_MAX_TEMPERATURE_HALF ? SCENE_MAX_TEMPERATURE_HALF
+                                                                       : temperature_half;
+            }
+        };
+    }
+}
+#endif
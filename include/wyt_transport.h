@@ -0,0 +1,127 @@
+#ifndef __WYT_TRANSPORT_H__
+#define __WYT_TRANSPORT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef USE_ARDUINO
+#include <Arduino.h>
+#endif
+
+#define LOOPBACK_BUFFER_SIZE 128
+#define POSIX_DEFAULT_TIMEOUT_MS 1000
+
+namespace pioneer_uart
+{
+    /*
+     * Transports move bytes between a `BasicPioneerWYT` and the WYT MCU. Any class with these members can be used:
+     *
+     *  - `size_t write(const uint8_t *bytes, size_t length)` sends bytes, returning how many were sent
+     *  - `void flush()` waits until all written bytes have been sent
+     *  - `size_t read(uint8_t *bytes, size_t length)` reads up to `length` bytes, waiting up to the transport's
+     *    timeout, returning how many were read
+     *
+     * Transports may also have `void setTimeout(uint32_t timeout_ms)`, to change how long `read` waits for each
+     * byte; it is needed for `setResponseTimeout()`.
+     *
+     * The transport is a template parameter rather than a virtual interface, so its calls can be inlined.
+     */
+
+#ifdef USE_ARDUINO
+    /** Sends over any Arduino `Stream`, through its virtual methods. Used by the `PioneerWYT(Stream &)` constructor. */
+    class StreamTransport
+    {
+    public:
+        explicit StreamTransport(Stream &stream) : m_stream(stream) {}
+        size_t write(const uint8_t *bytes, size_t length) { return m_stream.write(bytes, length); }
+        void flush() { m_stream.flush(); }
+        size_t read(uint8_t *bytes, size_t length) { return m_stream.readBytes(bytes, length); }
+        void setTimeout(uint32_t timeout_ms) { m_stream.setTimeout(timeout_ms); }
+
+    private:
+        Stream &m_stream;
+    };
+
+    /**
+     * Sends over a concrete serial class, such as `HardwareSerial` or `SoftwareSerial`. Calls are qualified with the
+     * serial class, so they are dispatched statically and can be inlined instead of going through the vtable.
+     */
+    template <typename SerialT>
+    class SerialTransport
+    {
+    public:
+        explicit SerialTransport(SerialT &serial) : m_serial(serial) {}
+        size_t write(const uint8_t *bytes, size_t length) { return m_serial.SerialT::write(bytes, length); }
+        void flush() { m_serial.SerialT::flush(); }
+        size_t read(uint8_t *bytes, size_t length) { return m_serial.SerialT::readBytes(bytes, length); }
+        void setTimeout(uint32_t timeout_ms) { m_serial.SerialT::setTimeout(timeout_ms); }
+
+    private:
+        SerialT &m_serial;
+    };
+
+    using HardwareSerialTransport = SerialTransport<HardwareSerial>;
+#elif defined(__unix__) || defined(__APPLE__)
+    /** Sends over a POSIX file descriptor, such as a serial port or pty, for running on a host. */
+    class PosixFdTransport
+    {
+    public:
+        /**
+         * @param fd an open file descriptor, which remains owned by the caller
+         * @param timeout_ms how long `read` waits for each byte before giving up
+         */
+        explicit PosixFdTransport(int fd, uint32_t timeout_ms = POSIX_DEFAULT_TIMEOUT_MS);
+        size_t write(const uint8_t *bytes, size_t length);
+        void flush();
+        size_t read(uint8_t *bytes, size_t length);
+        void setTimeout(uint32_t timeout_ms) { m_timeout_ms = timeout_ms; }
+
+        /**
+         * Opens a serial port and configures it for the WYT MCU (9600 baud, `8E1`, raw).
+         *
+         * @return the file descriptor, or -1 on errors
+         */
+        static int openSerialPort(const char *path);
+
+    private:
+        int m_fd;
+        uint32_t m_timeout_ms;
+    };
+#endif
+
+    /**
+     * Keeps everything in memory, for host tests and benchmarks. Responses queued with `queueReceived` are returned
+     * by `read`, and everything written is captured for inspection.
+     */
+    class LoopbackTransport
+    {
+    public:
+        LoopbackTransport();
+        size_t write(const uint8_t *bytes, size_t length);
+        void flush() {}
+        size_t read(uint8_t *bytes, size_t length);
+
+        /**
+         * Queues bytes to be returned by later reads.
+         *
+         * @return false if there was not enough room to queue all of them
+         */
+        bool queueReceived(const uint8_t *bytes, size_t length);
+        /** Returns the bytes written since the last `clearSent()`. */
+        const uint8_t *sent() const { return m_sent; }
+        /** Returns the number of bytes written since the last `clearSent()`, including any that did not fit. */
+        size_t sentLength() const { return m_sent_length; }
+        void clearSent() { m_sent_length = 0; }
+        /** Reads never wait, but the timeout is kept for inspection. */
+        void setTimeout(uint32_t timeout_ms) { m_timeout_ms = timeout_ms; }
+        uint32_t getTimeout() const { return m_timeout_ms; }
+
+    private:
+        uint8_t m_received[LOOPBACK_BUFFER_SIZE];
+        size_t m_received_start;
+        size_t m_received_end;
+        uint8_t m_sent[LOOPBACK_BUFFER_SIZE];
+        size_t m_sent_length;
+        uint32_t m_timeout_ms;
+    };
+}
+#endif
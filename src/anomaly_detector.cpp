@@ -0,0 +1,159 @@
+#include "anomaly_detector.h"
+#include <assert.h>
+#include <string.h>
+
+namespace pioneer_uart
+{
+  static inline uint8_t mode_group(response::OpMode mode)
+  {
+    switch (mode)
+    {
+    case response::OpMode::Heat:
+      return 0;
+    case response::OpMode::Cool:
+      return 1;
+    default:
+      return 2;
+    }
+  }
+
+  static inline uint8_t frequency_band(uint8_t frequency)
+  {
+    if (frequency == 0)
+    {
+      return 0;
+    }
+    uint8_t band = 1 + (frequency - 1) / 30;
+    return band < ANOMALY_FREQUENCY_BANDS ? band : ANOMALY_FREQUENCY_BANDS - 1;
+  }
+
+  /**
+   * Histogram bucket widths are powers of two chosen for each metric's usual range, so small-valued readings like
+   * current still spread across buckets. Readings beyond the last bucket are counted in it.
+   */
+  static const uint8_t BUCKET_SHIFTS[ANOMALY_METRICS] = {3, 3, 3, 1};
+
+  /** Index of the compressor frequency in the metrics, which has its own baselines */
+  static const uint8_t FREQUENCY_METRIC = 2;
+
+  static inline uint8_t bucket_of(uint8_t metric, uint8_t value)
+  {
+    uint8_t bucket = value >> BUCKET_SHIFTS[metric];
+    return bucket < ANOMALY_HISTOGRAM_BUCKETS ? bucket : ANOMALY_HISTOGRAM_BUCKETS - 1;
+  }
+
+  AnomalyDetector::AnomalyDetector(uint8_t sigmas) : m_sigmas(sigmas ? sigmas : 1), m_last_flags(0)
+  {
+    // With 0 every reading outside the histogram's central range would be flagged
+    assert(sigmas > 0);
+    reset();
+  }
+
+  void AnomalyDetector::reset()
+  {
+    memset(m_baselines, 0, sizeof(m_baselines));
+    memset(m_frequency_baselines, 0, sizeof(m_frequency_baselines));
+    m_last_flags = 0;
+  }
+
+  uint8_t AnomalyDetector::observe(const response::WytResponse &state)
+  {
+    if (!state.power)
+    {
+      m_last_flags = 0;
+      return 0;
+    }
+    const uint8_t values[ANOMALY_METRICS] = {
+        state.compressor_discharge_temp,
+        state.condenser_coil_temp,
+        state.compressor_frequency,
+        state.current_used_amps,
+    };
+    uint8_t group = mode_group(state.mode);
+    uint8_t band = frequency_band(state.compressor_frequency);
+    uint8_t flags = 0;
+    for (uint8_t metric = 0; metric < ANOMALY_METRICS; ++metric)
+    {
+      Baseline &baseline = metric == FREQUENCY_METRIC
+                               ? m_frequency_baselines[group]
+                               : m_baselines[group][band][metric < FREQUENCY_METRIC ? metric : metric - 1];
+      uint8_t bucket = bucket_of(metric, values[metric]);
+      if (check(baseline, values[metric], bucket))
+      {
+        flags |= 1 << metric;
+      }
+      update(baseline, values[metric], bucket);
+    }
+    m_last_flags = flags;
+    return flags;
+  }
+
+  bool AnomalyDetector::check(const Baseline &baseline, uint8_t value, uint8_t value_bucket) const
+  {
+    if (baseline.samples < ANOMALY_WARMUP_SAMPLES)
+    {
+      return false;
+    }
+    int32_t difference = (static_cast<int32_t>(value) << 8) - baseline.mean;
+    uint32_t squared = static_cast<uint32_t>(difference < 0 ? -difference : difference);
+    squared = squared * squared >> 8;
+    // Never treat a baseline as tighter than one unit, or constant readings would flag on the slightest change
+    uint32_t variance = baseline.variance < 256 ? 256 : baseline.variance;
+    // sigmas² (up to 2^16) times a variance of up to 2^24 needs more than 32 bits
+    if (squared <= static_cast<uint64_t>(m_sigmas) * m_sigmas * variance)
+    {
+      return false;
+    }
+
+    uint16_t total = 0;
+    for (uint8_t bucket = 0; bucket < ANOMALY_HISTOGRAM_BUCKETS; ++bucket)
+    {
+      total += baseline.histogram[bucket];
+    }
+    uint16_t tail = total * ANOMALY_TAIL_PERCENT / 100;
+    uint16_t below = 0;
+    for (uint8_t bucket = 0; bucket < value_bucket; ++bucket)
+    {
+      below += baseline.histogram[bucket];
+    }
+    uint16_t above = total - below - baseline.histogram[value_bucket];
+    return below >= total - tail || above >= total - tail;
+  }
+
+  void AnomalyDetector::update(Baseline &baseline, uint8_t value, uint8_t value_bucket)
+  {
+    int32_t sample = static_cast<int32_t>(value) << 8;
+    if (baseline.samples == 0)
+    {
+      baseline.mean = sample;
+      baseline.variance = 0;
+    }
+    else
+    {
+      int32_t difference = sample - baseline.mean;
+      baseline.mean += difference / (1 << ANOMALY_EWMA_SHIFT);
+      uint32_t magnitude = static_cast<uint32_t>(difference < 0 ? -difference : difference);
+      int32_t squared = static_cast<int32_t>(magnitude * magnitude >> 8);
+      baseline.variance += (squared - static_cast<int32_t>(baseline.variance)) / (1 << ANOMALY_EWMA_SHIFT);
+    }
+    if (baseline.samples < ANOMALY_WARMUP_SAMPLES)
+    {
+      ++baseline.samples;
+    }
+
+    uint8_t &count = baseline.histogram[value_bucket];
+    if (count == 0xff)
+    {
+      for (uint8_t bucket = 0; bucket < ANOMALY_HISTOGRAM_BUCKETS; ++bucket)
+      {
+        baseline.histogram[bucket] >>= 1;
+      }
+    }
+    ++count;
+  }
+
+  void AnomalyDetector::onStateUpdate(const response::WytResponse &state, void *context)
+  {
+    static_cast<AnomalyDetector *>(context)->observe(state);
+  }
+}
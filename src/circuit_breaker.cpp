@@ -0,0 +1,75 @@
+#include "circuit_breaker.h"
+
+namespace pioneer_uart
+{
+  CircuitBreaker::CircuitBreaker(uint8_t failure_threshold, uint32_t timeout_ms, uint32_t probe_timeout_ms,
+                                 uint32_t base_backoff_ms, uint32_t max_backoff_ms)
+      : m_timeout_ms(timeout_ms), m_probe_timeout_ms(probe_timeout_ms), m_base_backoff_ms(base_backoff_ms),
+        m_max_backoff_ms(max_backoff_ms), m_next_attempt_ms(0), m_random(1), m_failure_threshold(failure_threshold),
+        m_consecutive_failures(0), m_state(CircuitState::Closed)
+  {
+  }
+
+  void CircuitBreaker::seed(uint32_t seed)
+  {
+    // xorshift never leaves zero
+    m_random = seed ? seed : 1;
+  }
+
+  bool CircuitBreaker::shouldAttempt(uint32_t now_ms)
+  {
+    if (m_consecutive_failures && static_cast<int32_t>(now_ms - m_next_attempt_ms) < 0)
+    {
+      return false;
+    }
+    if (m_state == CircuitState::Open)
+    {
+      m_state = CircuitState::HalfOpen;
+    }
+    return true;
+  }
+
+  uint32_t CircuitBreaker::getTimeout() const
+  {
+    return m_state == CircuitState::HalfOpen ? m_probe_timeout_ms : m_timeout_ms;
+  }
+
+  void CircuitBreaker::recordSuccess()
+  {
+    m_consecutive_failures = 0;
+    m_state = CircuitState::Closed;
+  }
+
+  void CircuitBreaker::recordFailure(uint32_t now_ms)
+  {
+    if (m_consecutive_failures < 0xff)
+    {
+      ++m_consecutive_failures;
+    }
+    if (m_state == CircuitState::HalfOpen || m_consecutive_failures >= m_failure_threshold)
+    {
+      m_state = CircuitState::Open;
+    }
+    m_next_attempt_ms = now_ms + nextBackoff();
+  }
+
+  void CircuitBreaker::reset()
+  {
+    m_consecutive_failures = 0;
+    m_state = CircuitState::Closed;
+  }
+
+  uint32_t CircuitBreaker::nextBackoff()
+  {
+    uint8_t shift = m_consecutive_failures - 1;
+    shift = shift < CIRCUIT_BREAKER_MAX_BACKOFF_SHIFT ? shift : CIRCUIT_BREAKER_MAX_BACKOFF_SHIFT;
+    uint32_t backoff = m_base_backoff_ms > (m_max_backoff_ms >> shift) ? m_max_backoff_ms : m_base_backoff_ms << shift;
+
+    // "Equal jitter": at least half the backoff, so retries still slow down, plus a random part to spread them out
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    uint32_t half = backoff / 2;
+    return half + m_random % (half + 1);
+  }
+}
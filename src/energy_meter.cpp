@@ -0,0 +1,112 @@
+#include "energy_meter.h"
+
+namespace pioneer_uart
+{
+  void EnergyTotal::add(uint64_t watt_ms_to_add)
+  {
+    watt_ms_to_add += watt_ms;
+    watt_hours += watt_ms_to_add / WATT_MS_PER_WATT_HOUR;
+    watt_ms = watt_ms_to_add % WATT_MS_PER_WATT_HOUR;
+  }
+
+  static inline uint8_t mode_index(response::OpMode mode, bool power)
+  {
+    uint8_t index = static_cast<uint8_t>(mode);
+    return power && index < 6 ? index : 0;
+  }
+
+  EnergyMeter::EnergyMeter(uint32_t max_gap_ms) : m_max_gap_ms(max_gap_ms)
+  {
+    reset();
+  }
+
+  void EnergyMeter::reset()
+  {
+    const EnergyTotal zero = {0, 0};
+    m_total = zero;
+    for (uint8_t idx = 0; idx < 6; ++idx)
+    {
+      m_by_mode[idx] = zero;
+    }
+    for (uint8_t idx = 0; idx < ENERGY_METER_DAYS; ++idx)
+    {
+      m_by_day[idx] = zero;
+    }
+    m_unaccounted_ms = 0;
+    m_last_ms = 0;
+    m_last_power_va = 0;
+    m_day = 0;
+    m_today = 0;
+    m_last_mode_index = 0;
+    m_has_last = false;
+    m_has_day = false;
+  }
+
+  void EnergyMeter::addSample(uint32_t now_ms, uint16_t day, uint8_t volts, uint8_t amps, response::OpMode mode,
+                              bool power)
+  {
+    if (!m_has_day)
+    {
+      m_day = day;
+      m_has_day = true;
+    }
+    else if (day < m_day)
+    {
+      // The clock was set back; the energy in the current day's total was still used, so keep it there
+      m_day = day;
+    }
+    else if (day != m_day)
+    {
+      // Move on, clearing any days skipped without samples
+      uint16_t elapsed_days = day - m_day;
+      for (uint16_t idx = 0; idx < elapsed_days && idx < ENERGY_METER_DAYS; ++idx)
+      {
+        m_today = (m_today + 1) % ENERGY_METER_DAYS;
+        m_by_day[m_today].watt_hours = 0;
+        m_by_day[m_today].watt_ms = 0;
+      }
+      m_day = day;
+    }
+
+    uint16_t power_va = static_cast<uint16_t>(volts) * amps;
+    if (m_has_last)
+    {
+      uint32_t elapsed_ms = now_ms - m_last_ms;
+      if (elapsed_ms > m_max_gap_ms)
+      {
+        m_unaccounted_ms += elapsed_ms;
+      }
+      else
+      {
+        uint64_t energy = (static_cast<uint64_t>(m_last_power_va) + power_va) * elapsed_ms / 2;
+        m_total.add(energy);
+        m_by_mode[m_last_mode_index].add(energy);
+        m_by_day[m_today].add(energy);
+      }
+    }
+    m_last_ms = now_ms;
+    m_last_power_va = power_va;
+    m_last_mode_index = mode_index(mode, power);
+    m_has_last = true;
+  }
+
+  void EnergyMeter::addSample(const response::WytResponse &state, uint32_t now_ms, uint16_t day)
+  {
+    addSample(now_ms, day, state.supply_voltage, state.current_used_amps, state.mode, state.power);
+  }
+
+  EnergyTotal EnergyMeter::getForMode(response::OpMode mode) const
+  {
+    return m_by_mode[mode_index(mode, true)];
+  }
+
+  EnergyTotal EnergyMeter::getForDay(uint8_t days_ago) const
+  {
+    if (days_ago >= ENERGY_METER_DAYS)
+    {
+      const EnergyTotal zero = {0, 0};
+      return zero;
+    }
+    return m_by_day[(m_today + ENERGY_METER_DAYS - days_ago) % ENERGY_METER_DAYS];
+  }
+}
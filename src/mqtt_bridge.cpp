@@ -0,0 +1,336 @@
+#include "mqtt_bridge.h"
+#include "state_serializer.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace pioneer_uart
+{
+  /** Jinja template for a Home Assistant value that renders empty when `key` was not in the published JSON */
+#define MQTT_BRIDGE_FIELD_TEMPLATE(key) \
+  "{%% if value_json." key " is defined %%}{{ value_json." key " }}{%% endif %%}"
+
+  // Home Assistant ignores values that render empty, so states that only carry some fields leave the rest alone.
+  // This is a format string for the base topic, name, unique ID twice, name again and the temperature range, hence
+  // the `%%`.
+  static const char DISCOVERY_CONFIG[] =
+      "{\"~\":\"%s\",\"name\":\"%s\",\"uniq_id\":\"%s\","
+      "\"dev\":{\"ids\":[\"%s\"],\"name\":\"%s\",\"mf\":\"Pioneer\",\"mdl\":\"WYT\"},"
+      "\"modes\":[\"off\",\"auto\",\"cool\",\"heat\",\"dry\",\"fan_only\"],"
+      "\"fan_modes\":[\"auto\",\"low\",\"medium\",\"mid_low\",\"mid_high\",\"high\"],"
+      "\"min_temp\":%d,\"max_temp\":%d,\"temp_step\":0.5,\"precision\":0.1,\"temp_unit\":\"C\","
+      "\"curr_temp_t\":\"~/state\",\"curr_temp_tpl\":\"" MQTT_BRIDGE_FIELD_TEMPLATE("indoor_temperature") "\","
+      "\"temp_stat_t\":\"~/state\",\"temp_stat_tpl\":\"" MQTT_BRIDGE_FIELD_TEMPLATE("chosen_temperature") "\","
+      "\"fan_mode_stat_t\":\"~/state\",\"fan_mode_stat_tpl\":\"" MQTT_BRIDGE_FIELD_TEMPLATE("chosen_fan_speed") "\","
+      "\"mode_stat_t\":\"~/state\",\"mode_stat_tpl\":\"{%% if value_json.power is defined and not value_json.power %%}off"
+      "{%% elif value_json.mode is defined %%}"
+      "{{ {'dehumidify': 'dry', 'fan': 'fan_only'}.get(value_json.mode, value_json.mode) }}{%% endif %%}\""
+#ifndef PIONEER_UART_READ_ONLY
+      ",\"mode_cmd_t\":\"~/set/mode\",\"temp_cmd_t\":\"~/set/chosen_temperature\","
+      "\"fan_mode_cmd_t\":\"~/set/chosen_fan_speed\""
+#endif
+      "}";
+
+  MqttBridge::MqttBridge(MqttClient &client, const char *base_topic, uint32_t debounce_ms, uint32_t full_interval_ms)
+      : m_client(client), m_full_interval_ms(full_interval_ms), m_last_full_ms(0), m_full_due(true)
+#ifndef PIONEER_UART_READ_ONLY
+        ,
+        m_debounce_ms(debounce_ms), m_last_command_ms(0), m_has_commands(false)
+#endif
+  {
+#ifdef PIONEER_UART_READ_ONLY
+    (void)debounce_ms;
+#endif
+    strncpy(m_base_topic, base_topic, MQTT_BRIDGE_MAX_TOPIC_SIZE - 1);
+    m_base_topic[MQTT_BRIDGE_MAX_TOPIC_SIZE - 1] = '\0';
+    m_base_topic_length = strlen(m_base_topic);
+    memset(m_published.bytes, 0, RESPONSE_SIZE);
+  }
+
+  bool MqttBridge::topic(char *out, const char *suffix) const
+  {
+    int length = snprintf(out, MQTT_BRIDGE_MAX_TOPIC_SIZE, "%s%s", m_base_topic, suffix);
+    return length > 0 && length < MQTT_BRIDGE_MAX_TOPIC_SIZE;
+  }
+
+  bool MqttBridge::begin()
+  {
+    m_full_due = true;
+#ifndef PIONEER_UART_READ_ONLY
+    char filter[MQTT_BRIDGE_MAX_TOPIC_SIZE];
+    return topic(filter, "/set/+") && m_client.subscribe(filter);
+#else
+    return true;
+#endif
+  }
+
+  bool MqttBridge::publishState(const WytResponse &state, uint32_t now_ms)
+  {
+    bool full = m_full_due || now_ms - m_last_full_ms >= m_full_interval_ms || state.power != m_published.power ||
+                state.mode != m_published.mode;
+    if (!full && memcmp(state.bytes, m_published.bytes, RESPONSE_SIZE) == 0)
+    {
+      return true;
+    }
+    size_t length = serializer::to_json(state, m_buffer, MQTT_BRIDGE_BUFFER_SIZE, full ? nullptr : &m_published);
+    if (length == 0)
+    {
+      return false;
+    }
+    // Only unknown bytes changed
+    if (length == 2)
+    {
+      m_published = state;
+      return true;
+    }
+    char state_topic[MQTT_BRIDGE_MAX_TOPIC_SIZE];
+    if (!topic(state_topic, "/state") || !m_client.publish(state_topic, m_buffer, length, full))
+    {
+      return false;
+    }
+    m_published = state;
+    if (full)
+    {
+      m_full_due = false;
+      m_last_full_ms = now_ms;
+    }
+    return true;
+  }
+
+  static bool is_valid_unique_id(const char *unique_id)
+  {
+    if (!*unique_id)
+    {
+      return false;
+    }
+    for (; *unique_id; ++unique_id)
+    {
+      char c = *unique_id;
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-'))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Copies `in` into `out` as the contents of a JSON string, returning false if it did not fit in `capacity` */
+  static bool json_escape(const char *in, char *out, size_t capacity)
+  {
+    size_t length = 0;
+    for (; *in; ++in)
+    {
+      unsigned char c = *in;
+      int written;
+      if (c == '"' || c == '\\')
+      {
+        written = snprintf(out + length, capacity - length, "\\%c", c);
+      }
+      else if (c < 0x20)
+      {
+        written = snprintf(out + length, capacity - length, "\\u%04x", c);
+      }
+      else
+      {
+        written = snprintf(out + length, capacity - length, "%c", c);
+      }
+      if (written < 0 || static_cast<size_t>(written) >= capacity - length)
+      {
+        return false;
+      }
+      length += written;
+    }
+    out[length] = '\0';
+    return true;
+  }
+
+  size_t MqttBridge::discoveryConfig(char *out, size_t capacity, const char *unique_id, const char *name) const
+  {
+    char escaped_name[MQTT_BRIDGE_MAX_NAME_SIZE];
+    if (!is_valid_unique_id(unique_id) || !json_escape(name, escaped_name, sizeof(escaped_name)))
+    {
+      return 0;
+    }
+    int length = snprintf(out, capacity, DISCOVERY_CONFIG, m_base_topic, escaped_name, unique_id, unique_id,
+                          escaped_name, MQTT_BRIDGE_MIN_TEMPERATURE, MQTT_BRIDGE_MAX_TEMPERATURE);
+    return length > 0 && static_cast<size_t>(length) < capacity ? length : 0;
+  }
+
+  bool MqttBridge::publishDiscovery(const char *unique_id, const char *name)
+  {
+    size_t length = discoveryConfig(m_buffer, MQTT_BRIDGE_BUFFER_SIZE, unique_id, name);
+    char config_topic[MQTT_BRIDGE_MAX_TOPIC_SIZE];
+    int topic_length = snprintf(config_topic, sizeof(config_topic), MQTT_BRIDGE_DISCOVERY_PREFIX "/climate/%s/config",
+                                unique_id);
+    if (length == 0 || topic_length <= 0 || topic_length >= MQTT_BRIDGE_MAX_TOPIC_SIZE)
+    {
+      return false;
+    }
+    return m_client.publish(config_topic, m_buffer, length, true);
+  }
+
+#ifndef PIONEER_UART_READ_ONLY
+  static inline bool matches(const char *value, size_t length, const char *expected)
+  {
+    return strlen(expected) == length && memcmp(value, expected, length) == 0;
+  }
+
+  static bool parse_bool(const char *value, size_t length, bool &result)
+  {
+    if (matches(value, length, "on") || matches(value, length, "ON") || matches(value, length, "true") ||
+        matches(value, length, "1"))
+    {
+      result = true;
+      return true;
+    }
+    if (matches(value, length, "off") || matches(value, length, "OFF") || matches(value, length, "false") ||
+        matches(value, length, "0"))
+    {
+      result = false;
+      return true;
+    }
+    return false;
+  }
+
+  /** Parses a decimal like `24` or `24.5` into tenths, without floating point; further decimals are dropped */
+  static bool parse_tenths(const char *value, size_t length, int16_t &tenths)
+  {
+    int16_t whole = 0;
+    size_t idx = 0;
+    for (; idx < length && value[idx] >= '0' && value[idx] <= '9' && whole < 100; ++idx)
+    {
+      whole = whole * 10 + (value[idx] - '0');
+    }
+    if (idx == 0)
+    {
+      return false;
+    }
+    int16_t fraction = 0;
+    if (idx < length && value[idx] == '.')
+    {
+      ++idx;
+      if (idx < length && value[idx] >= '0' && value[idx] <= '9')
+      {
+        fraction = value[idx] - '0';
+      }
+      while (idx < length && value[idx] >= '0' && value[idx] <= '9')
+      {
+        ++idx;
+      }
+    }
+    tenths = whole * 10 + fraction;
+    return idx == length;
+  }
+
+  typedef void (DesiredState::*BoolSetter)(bool);
+
+  struct BoolCommand
+  {
+    const char *key;
+    BoolSetter setter;
+  };
+
+  static const BoolCommand BOOL_COMMANDS[] = {
+      {"power", &DesiredState::setPowerOn},
+      {"eco", &DesiredState::setEco},
+      {"display", &DesiredState::setDisplayOn},
+      {"strong", &DesiredState::setStrong},
+      {"health", &DesiredState::setHealth},
+      {"mute", &DesiredState::setMute},
+  };
+
+  bool MqttBridge::handleMessage(const char *topic, const uint8_t *payload, size_t length, uint32_t now_ms)
+  {
+    if (strncmp(topic, m_base_topic, m_base_topic_length) != 0 ||
+        strncmp(topic + m_base_topic_length, "/set/", 5) != 0)
+    {
+      return false;
+    }
+    if (collectCommand(topic + m_base_topic_length + 5, reinterpret_cast<const char *>(payload), length))
+    {
+      m_last_command_ms = now_ms;
+      m_has_commands = true;
+    }
+    return true;
+  }
+
+  bool MqttBridge::collectCommand(const char *key, const char *value, size_t length)
+  {
+    for (size_t idx = 0; idx < sizeof(BOOL_COMMANDS) / sizeof(BOOL_COMMANDS[0]); ++idx)
+    {
+      bool on;
+      if (strcmp(key, BOOL_COMMANDS[idx].key) == 0)
+      {
+        if (!parse_bool(value, length, on))
+        {
+          return false;
+        }
+        (m_commands.*BOOL_COMMANDS[idx].setter)(on);
+        return true;
+      }
+    }
+    if (strcmp(key, "chosen_temperature") == 0)
+    {
+      int16_t tenths;
+      if (!parse_tenths(value, length, tenths) || tenths < MQTT_BRIDGE_MIN_TEMPERATURE * 10 ||
+          tenths > MQTT_BRIDGE_MAX_TEMPERATURE * 10)
+      {
+        return false;
+      }
+      m_commands.setChosenTemperature(from_half_degrees(tenths / 5));
+      return true;
+    }
+
+    uint8_t raw;
+    if (strcmp(key, "mode") == 0)
+    {
+      if (matches(value, length, "off"))
+      {
+        m_commands.setPowerOn(false);
+        return true;
+      }
+      if (matches(value, length, "dry"))
+      {
+        raw = static_cast<uint8_t>(OpMode::Dehumidify);
+      }
+      else if (matches(value, length, "fan_only"))
+      {
+        raw = static_cast<uint8_t>(OpMode::Fan);
+      }
+      else if (!serializer::from_name(key, value, length, raw))
+      {
+        return false;
+      }
+      // Choosing a mode in Home Assistant also means turning the unit on
+      m_commands.setPowerOn(true);
+      m_commands.setMode(static_cast<OpMode>(raw));
+      return true;
+    }
+    if (!serializer::from_name(key, value, length, raw))
+    {
+      return false;
+    }
+    if (strcmp(key, "chosen_fan_speed") == 0)
+    {
+      m_commands.setChosenFanSpeed(static_cast<FanSpeed>(raw));
+    }
+    else if (strcmp(key, "sleep_mode") == 0)
+    {
+      m_commands.setSleepMode(static_cast<SleepMode>(raw));
+    }
+    else if (strcmp(key, "up_down_flow") == 0)
+    {
+      m_commands.setUpDownFlow(static_cast<UpDownFlow>(raw));
+    }
+    else if (strcmp(key, "left_right_flow") == 0)
+    {
+      m_commands.setLeftRightFlow(static_cast<LeftRightFlow>(raw));
+    }
+    else
+    {
+      // Enumerations that can only be read, like `indoor_fan_speed`
+      return false;
+    }
+    return true;
+  }
+#endif
+}
@@ -1,324 +1,325 @@
 #include "pioneer_uart.h"
-
-#define SET_TEMPERATURE_BASE 111
+#include <string.h>
 
 namespace pioneer_uart
 {
-  PioneerWYT::PioneerWYT() {}
-  PioneerWYT::~PioneerWYT()
+  PioneerWYTBase::PioneerWYTBase() {}
+  PioneerWYTBase::PioneerWYTBase(StateStore &store) : m_store(&store)
   {
-    clearPendingCommand();
+    restoreState();
   }
+
+  PioneerWYT::PioneerWYT() {}
+  PioneerWYT::PioneerWYT(StateStore &store) : PioneerWYTBase(store) {}
 #ifdef USE_ARDUINO
   PioneerWYT::PioneerWYT(Stream &serial) : m_serial(&serial)
   {
   }
+  PioneerWYT::PioneerWYT(Stream &serial, StateStore &store) : PioneerWYTBase(store), m_serial(&serial)
+  {
+  }
   bool PioneerWYT::pollState()
   {
     if (!m_serial)
     {
       return false;
     }
-    command::WytQueryCommand query = command::query_command();
-    m_serial->write(query.bytes, QUERY_COMMAND_SIZE);
-    m_serial->flush();
-    uint8_t state_buf[RESPONSE_SIZE];
-    size_t bytes_read = m_serial->readBytes(state_buf, RESPONSE_SIZE);
-    if (bytes_read < RESPONSE_SIZE)
+    StreamTransport transport(*m_serial);
+    return pollStateWith(transport);
+  }
+#ifndef PIONEER_UART_READ_ONLY
+  bool PioneerWYT::applySettings()
+  {
+    if (!m_serial)
     {
       return false;
     }
-    m_state = from_bytes(state_buf);
-    return true;
+    StreamTransport transport(*m_serial);
+    return applySettingsWith(transport);
   }
-  bool PioneerWYT::applySettings()
+#endif
+  bool PioneerWYT::sendFrame(const uint8_t frame[STATE_COMMAND_SIZE])
   {
     if (!m_serial)
     {
       return false;
     }
-    if (!m_pending_command)
+    StreamTransport transport(*m_serial);
+    return sendFrameWith(transport, frame);
+  }
+  bool PioneerWYT::sendFrame_P(const uint8_t *frame)
+  {
+    uint8_t bytes[STATE_COMMAND_SIZE];
+    memcpy_P(bytes, frame, STATE_COMMAND_SIZE);
+    return sendFrame(bytes);
+  }
+  void PioneerWYT::setResponseTimeout(uint32_t timeout_ms)
+  {
+    if (m_serial)
     {
-      return false;
+      m_serial->setTimeout(timeout_ms);
     }
-    set_checksum(m_pending_command);
-    m_serial->write(m_pending_command->bytes, STATE_COMMAND_SIZE);
-    m_serial->flush();
-    clearPendingCommand();
-    return pollState();
+  }
+#endif
+#ifdef PIONEER_UART_TRACE
+  void PioneerWYTBase::setTracer(WireTracer *tracer)
+  {
+    m_tracer = tracer;
   }
 #endif
 
-  bool PioneerWYT::isPowerOn() const
+  void PioneerWYTBase::restoreState()
+  {
+    if (m_store && m_store->load(m_state))
+    {
+      m_has_state = true;
+      m_state_restored = true;
+    }
+  }
+
+  void PioneerWYTBase::updateState(const WytResponse &state)
+  {
+    // Sensor readings change on nearly every poll, so only save when settings change, to spare flash/EEPROM wear
+    bool should_save = m_store && (!m_has_state || !has_same_settings(m_state, state));
+    m_state = state;
+    m_has_state = true;
+    m_state_restored = false;
+    if (should_save)
+    {
+      m_store->save(m_state);
+    }
+    if (m_state_callback)
+    {
+      m_state_callback(m_state, m_state_callback_context);
+    }
+  }
+
+  void PioneerWYTBase::setStateCallback(StateCallback callback, void *context)
+  {
+    m_state_callback = callback;
+    m_state_callback_context = context;
+  }
+
+  bool PioneerWYTBase::hasState() const { return m_has_state; }
+  bool PioneerWYTBase::isStateRestored() const { return m_state_restored; }
+  const WytResponse &PioneerWYTBase::getRawState() const { return m_state; }
+  bool PioneerWYTBase::isPowerOn() const
   {
     return m_state.power;
   }
-  bool PioneerWYT::isEco() const { return m_state.eco; }
-  bool PioneerWYT::isDisplayOn() const { return m_state.display; }
-  bool PioneerWYT::isStrong() const { return m_state.strong; }
-  bool PioneerWYT::isHealth() const { return m_state.health; }
-  bool PioneerWYT::isMute() const { return m_state.mute; };
-  bool PioneerWYT::isVerticalFlow() const { return m_state.vertical_flow; }
-  bool PioneerWYT::isHorizontalFlow() const { return m_state.horizontal_flow; }
-  bool PioneerWYT::isFourWayValveOn() const { return m_state.four_way_valve_on; }
-  bool PioneerWYT::isAntifreeze() const { return m_state.antifreeze; }
-  bool PioneerWYT::isHeatMode() const { return m_state.heat_mode; }
-  OpMode PioneerWYT::getMode() const { return m_state.mode; }
-  FanSpeed PioneerWYT::getChosenFanSpeed() const { return m_state.fan_speed; }
-  DegreesC PioneerWYT::getChosenTemperature() const
+  bool PioneerWYTBase::isEco() const { return m_state.eco; }
+  bool PioneerWYTBase::isDisplayOn() const { return m_state.display; }
+  bool PioneerWYTBase::isStrong() const { return m_state.strong; }
+  bool PioneerWYTBase::isHealth() const { return m_state.health; }
+  bool PioneerWYTBase::isMute() const { return m_state.mute; };
+  bool PioneerWYTBase::isVerticalFlow() const { return m_state.vertical_flow; }
+  bool PioneerWYTBase::isHorizontalFlow() const { return m_state.horizontal_flow; }
+  bool PioneerWYTBase::isFourWayValveOn() const { return m_state.four_way_valve_on; }
+  bool PioneerWYTBase::isAntifreeze() const { return m_state.antifreeze; }
+  bool PioneerWYTBase::isHeatMode() const { return m_state.heat_mode; }
+  OpMode PioneerWYTBase::getMode() const { return m_state.mode; }
+  FanSpeed PioneerWYTBase::getChosenFanSpeed() const { return m_state.fan_speed; }
+  DegreesC PioneerWYTBase::getChosenTemperature() const
+  {
+    return from_half_degrees(get_chosen_temperature_half(m_state));
+  }
+#ifdef PIONEER_UART_FIXED_POINT
+  DegreesC PioneerWYTBase::getIndoorTemperature() const
   {
-    return SET_TEMPERATURE_BASE - m_state.set_temperature_whole -
-           (m_state.set_temperature_half ? 0.5 : 0);
+    return indoor_sensor_decidegrees_c(m_state.indoor_temp_base);
   }
-  DegreesC PioneerWYT::getIndoorTemperature() const
+  DegreesC PioneerWYTBase::getIndoorHeatExchangerTemperature() const
   {
-    return m_state.indoor_temp_base * 0.3 - 11.5;
+    return indoor_sensor_decidegrees_c(m_state.indoor_heat_exchanger_temp);
   }
-  DegreesC PioneerWYT::getIndoorHeatExchangerTemperature() const
+#else
+  DegreesC PioneerWYTBase::getIndoorTemperature() const
   {
-    return m_state.indoor_heat_exchanger_temp * 0.3 - 11.5;
+    return indoor_sensor_degrees_c(m_state.indoor_temp_base);
   }
-  DegreesC PioneerWYT::getOutdoorTemperature() const
+  DegreesC PioneerWYTBase::getIndoorHeatExchangerTemperature() const
+  {
+    return indoor_sensor_degrees_c(m_state.indoor_heat_exchanger_temp);
+  }
+#endif
+  DegreesC PioneerWYTBase::getOutdoorTemperature() const
   {
-    return static_cast<float>(m_state.outdoor_temp);
+    return WYT_DEGREES_C(m_state.outdoor_temp);
   }
-  DegreesC PioneerWYT::getCondenserCoilTemperature() const
+  DegreesC PioneerWYTBase::getCondenserCoilTemperature() const
   {
-    return static_cast<float>(m_state.condenser_coil_temp);
+    return WYT_DEGREES_C(m_state.condenser_coil_temp);
   }
-  DegreesC PioneerWYT::getCompressorDischargeTemperature() const
+  DegreesC PioneerWYTBase::getCompressorDischargeTemperature() const
   {
-    return static_cast<float>(m_state.compressor_discharge_temp);
+    return WYT_DEGREES_C(m_state.compressor_discharge_temp);
   }
-  uint8_t PioneerWYT::getCompressorFrequency() const
+  uint8_t PioneerWYTBase::getCompressorFrequency() const
   {
     return m_state.compressor_frequency;
   }
-  IndoorFanSpeed PioneerWYT::getIndoorFanSpeed() const
+  IndoorFanSpeed PioneerWYTBase::getIndoorFanSpeed() const
   {
     return m_state.indoor_fan_speed;
   }
-  uint8_t PioneerWYT::getOutdoorFanSpeed() const
+  uint8_t PioneerWYTBase::getOutdoorFanSpeed() const
   {
     return m_state.outdoor_fan_speed;
   }
-  uint8_t PioneerWYT::getSupplyVoltage() const
+  uint8_t PioneerWYTBase::getSupplyVoltage() const
   {
     return m_state.supply_voltage;
   }
-  uint8_t PioneerWYT::getCurrentUsedAmps() const
+  uint8_t PioneerWYTBase::getCurrentUsedAmps() const
   {
     return m_state.current_used_amps;
   }
-  UpDownFlow PioneerWYT::getUpDownFlow() const
+  UpDownFlow PioneerWYTBase::getUpDownFlow() const
   {
     return m_state.up_down_flow;
   }
-  LeftRightFlow PioneerWYT::getLeftRightFlow() const
+  LeftRightFlow PioneerWYTBase::getLeftRightFlow() const
   {
     return m_state.left_right_flow;
   }
-  SleepMode PioneerWYT::getSleepMode() const { return m_state.sleep; }
+  SleepMode PioneerWYTBase::getSleepMode() const { return m_state.sleep; }
 
-  bool PioneerWYT::serializePendingState(uint8_t bytes[STATE_COMMAND_SIZE]) const
+#ifndef PIONEER_UART_READ_ONLY
+  bool PioneerWYTBase::serializePendingState(uint8_t bytes[STATE_COMMAND_SIZE]) const
   {
-    if (!m_pending_command)
+    if (!m_has_pending_command)
     {
       return false;
     }
-    memcpy(bytes, m_pending_command->bytes, STATE_COMMAND_SIZE);
-    set_checksum((command::WytStateCommand *)(bytes));
+    memcpy(bytes, m_pending_command.bytes, STATE_COMMAND_SIZE);
+    set_checksum((command::WytSetStateCommand *)(bytes));
     return true;
   }
+#endif
 
-  void PioneerWYT::deserializeState(const uint8_t bytes[RESPONSE_SIZE])
+  void PioneerWYTBase::deserializeState(const uint8_t bytes[RESPONSE_SIZE])
   {
-    m_state = from_bytes(bytes);
+    updateState(from_bytes(bytes));
   }
 
-  void PioneerWYT::clearPendingCommand()
+  void PioneerWYTBase::clearPendingCommand()
   {
-    if (m_pending_command)
-    {
-      delete m_pending_command;
-      m_pending_command = nullptr;
-    }
+#ifndef PIONEER_UART_READ_ONLY
+    m_has_pending_command = false;
+#endif
   }
 
-  void PioneerWYT::initPendingCommand()
+#ifndef PIONEER_UART_READ_ONLY
+  void PioneerWYTBase::initPendingCommand()
   {
-    clearPendingCommand();
-    m_pending_command = new command::WytStateCommand(command::from_response(m_state));
+    m_pending_command = command::from_response(m_state);
+    m_has_pending_command = true;
   }
 
-  void PioneerWYT::setPowerOn(bool power)
-  {
-    checkOrInitCommand();
-    m_pending_command->power = power;
-  }
-  void PioneerWYT::setEco(bool eco)
-  {
-    checkOrInitCommand();
-    m_pending_command->eco = eco;
-  }
-  void PioneerWYT::setDisplayOn(bool display)
-  {
-    checkOrInitCommand();
-    m_pending_command->display = display;
-  }
-  void PioneerWYT::setStrong(bool strong)
+  void PioneerWYTBase::setPowerOn(bool power)
   {
     checkOrInitCommand();
-    m_pending_command->strong = strong;
+    m_pending_command.power = power;
   }
-  void PioneerWYT::setHealth(bool health)
-  {
-    checkOrInitCommand();
-    m_pending_command->health = health;
-  }
-  void PioneerWYT::setMute(bool mute)
-  {
-    checkOrInitCommand();
-    m_pending_command->mute = mute;
-  }
-  void PioneerWYT::setMode(OpMode mode)
+  void PioneerWYTBase::setMode(OpMode mode)
   {
     checkOrInitCommand();
     switch (mode)
     {
     case OpMode::Auto:
-      m_pending_command->mode = command::OpMode::Auto;
+      m_pending_command.mode = command::OpMode::Auto;
       break;
     case OpMode::Heat:
-      m_pending_command->mode = command::OpMode::Heat;
+      m_pending_command.mode = command::OpMode::Heat;
       break;
     case OpMode::Cool:
-      m_pending_command->mode = command::OpMode::Cool;
+      m_pending_command.mode = command::OpMode::Cool;
       break;
     case OpMode::Dehumidify:
-      m_pending_command->mode = command::OpMode::Dehumidify;
+      m_pending_command.mode = command::OpMode::Dehumidify;
       break;
     case OpMode::Fan:
-      m_pending_command->mode = command::OpMode::Fan;
+      m_pending_command.mode = command::OpMode::Fan;
       break;
     }
   }
-  void PioneerWYT::setChosenFanSpeed(FanSpeed speed)
+  void PioneerWYTBase::setChosenFanSpeed(FanSpeed speed)
   {
     checkOrInitCommand();
     switch (speed)
     {
     case FanSpeed::Auto:
-      m_pending_command->fan_speed = command::FanSpeed::Auto;
+      m_pending_command.fan_speed = command::FanSpeed::Auto;
       break;
     case FanSpeed::High:
-      m_pending_command->fan_speed = command::FanSpeed::High;
+      m_pending_command.fan_speed = command::FanSpeed::High;
       break;
     case FanSpeed::Low:
-      m_pending_command->fan_speed = command::FanSpeed::Low;
+      m_pending_command.fan_speed = command::FanSpeed::Low;
+      break;
+    case FanSpeed::Medium:
+      m_pending_command.fan_speed = command::FanSpeed::Medium;
       break;
     case FanSpeed::MidHigh:
-      m_pending_command->fan_speed = command::FanSpeed::MidHigh;
+      m_pending_command.fan_speed = command::FanSpeed::MidHigh;
       break;
     case FanSpeed::MidLow:
-      m_pending_command->fan_speed = command::FanSpeed::MidLow;
+      m_pending_command.fan_speed = command::FanSpeed::MidLow;
       break;
     }
   }
-  void PioneerWYT::setChosenTemperature(DegreesC temperature)
+  void PioneerWYTBase::setChosenTemperature(DegreesC temperature)
   {
     checkOrInitCommand();
-    command::set_chosen_temperature_degrees_c(*m_pending_command, temperature);
+    command::set_chosen_temperature_half(m_pending_command, to_half_degrees(temperature));
   }
-  void PioneerWYT::setUpDownFlow(UpDownFlow flow)
+#ifndef PIONEER_UART_BASIC_SETTERS
+  void PioneerWYTBase::setEco(bool eco)
   {
     checkOrInitCommand();
-    switch (flow)
-    {
-    case UpDownFlow::Auto:
-      m_pending_command->up_down_flow = command::UpDownFlow::Auto;
-      break;
-    case UpDownFlow::TopFix:
-      m_pending_command->up_down_flow = command::UpDownFlow::TopFix;
-      break;
-    case UpDownFlow::UpperFix:
-      m_pending_command->up_down_flow = command::UpDownFlow::UpperFix;
-      break;
-    case UpDownFlow::MiddleFix:
-      m_pending_command->up_down_flow = command::UpDownFlow::MiddleFix;
-      break;
-    case UpDownFlow::LowerFix:
-      m_pending_command->up_down_flow = command::UpDownFlow::LowerFix;
-      break;
-    case UpDownFlow::BottomFix:
-      m_pending_command->up_down_flow = command::UpDownFlow::BottomFix;
-      break;
-    case UpDownFlow::UpDownFlow:
-      m_pending_command->up_down_flow = command::UpDownFlow::UpDownFlow;
-      break;
-    case UpDownFlow::UpFlow:
-      m_pending_command->up_down_flow = command::UpDownFlow::UpFlow;
-      break;
-    case UpDownFlow::DownFlow:
-      m_pending_command->up_down_flow = command::UpDownFlow::DownFlow;
-      break;
-    }
+    m_pending_command.eco = eco;
   }
-  void PioneerWYT::setLeftRightFlow(LeftRightFlow flow)
+  void PioneerWYTBase::setDisplayOn(bool display)
   {
     checkOrInitCommand();
-    switch (flow)
-    {
-    case LeftRightFlow::Auto:
-      m_pending_command->left_right_flow = command::LeftRightFlow::Auto;
-      break;
-    case LeftRightFlow::LeftFix:
-      m_pending_command->left_right_flow = command::LeftRightFlow::LeftFix;
-      break;
-    case LeftRightFlow::MiddleLeftFix:
-      m_pending_command->left_right_flow = command::LeftRightFlow::MiddleLeftFix;
-      break;
-    case LeftRightFlow::MiddleFix:
-      m_pending_command->left_right_flow = command::LeftRightFlow::MiddleFix;
-      break;
-    case LeftRightFlow::MiddleRightFix:
-      m_pending_command->left_right_flow = command::LeftRightFlow::MiddleRightFix;
-      break;
-    case LeftRightFlow::RightFix:
-      m_pending_command->left_right_flow = command::LeftRightFlow::RightFix;
-      break;
-    case LeftRightFlow::LeftRightFlow:
-      m_pending_command->left_right_flow = command::LeftRightFlow::LeftRightFlow;
-      break;
-    case LeftRightFlow::LeftFlow:
-      m_pending_command->left_right_flow = command::LeftRightFlow::LeftFlow;
-      break;
-    case LeftRightFlow::MiddleFlow:
-      m_pending_command->left_right_flow = command::LeftRightFlow::MiddleFlow;
-      break;
-    case LeftRightFlow::RightFlow:
-      m_pending_command->left_right_flow = command::LeftRightFlow::RightFlow;
-      break;
-    }
+    m_pending_command.display = display;
   }
-  void PioneerWYT::setSleepMode(SleepMode sleep)
+  void PioneerWYTBase::setStrong(bool strong)
   {
     checkOrInitCommand();
-    switch (sleep)
-    {
-    case SleepMode::Off:
-      m_pending_command->sleep = command::SleepMode::Off;
-      break;
-    case SleepMode::Standard:
-      m_pending_command->sleep = command::SleepMode::Standard;
-      break;
-    case SleepMode::Child:
-      m_pending_command->sleep = command::SleepMode::Child;
-      break;
-    case SleepMode::Elderly:
-      m_pending_command->sleep = command::SleepMode::Elderly;
-      break;
-    }
+    m_pending_command.strong = strong;
+  }
+  void PioneerWYTBase::setHealth(bool health)
+  {
+    checkOrInitCommand();
+    m_pending_command.health = health;
+  }
+  void PioneerWYTBase::setMute(bool mute)
+  {
+    checkOrInitCommand();
+    m_pending_command.mute = mute;
+    // As in commands built from a response, the beeper is only on when not muted
+    m_pending_command.beeper = !mute;
   }
+  void PioneerWYTBase::setUpDownFlow(UpDownFlow flow)
+  {
+    checkOrInitCommand();
+    // Same encoding in commands as in responses
+    m_pending_command.up_down_flow = static_cast<command::UpDownFlow>(flow);
+  }
+  void PioneerWYTBase::setLeftRightFlow(LeftRightFlow flow)
+  {
+    checkOrInitCommand();
+    // Commands use the response encoding with the top bit set
+    m_pending_command.left_right_flow = static_cast<command::LeftRightFlow>(static_cast<uint8_t>(flow) | 0x80);
+  }
+  void PioneerWYTBase::setSleepMode(SleepMode sleep)
+  {
+    checkOrInitCommand();
+    // Same encoding in commands as in responses
+    m_pending_command.sleep = static_cast<command::SleepMode>(sleep);
+  }
+#endif
+#endif
 
 } // namespace pioneer_uart
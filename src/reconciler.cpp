@@ -0,0 +1,206 @@
+#include "reconciler.h"
+
+#ifndef PIONEER_UART_READ_ONLY
+namespace pioneer_uart
+{
+  DesiredState::DesiredState()
+      : m_fields(0), m_power(false), m_eco(false), m_display(false), m_strong(false), m_health(false), m_mute(false),
+        m_mode(OpMode::Auto), m_fan_speed(FanSpeed::Auto), m_temperature_half(0), m_sleep(SleepMode::Off),
+        m_up_down_flow(UpDownFlow::Auto), m_left_right_flow(LeftRightFlow::Auto)
+  {
+  }
+
+  void DesiredState::setPowerOn(bool power)
+  {
+    m_power = power;
+    m_fields |= DesiredPower;
+  }
+  void DesiredState::setEco(bool eco)
+  {
+    m_eco = eco;
+    m_fields |= DesiredEco;
+  }
+  void DesiredState::setDisplayOn(bool display)
+  {
+    m_display = display;
+    m_fields |= DesiredDisplay;
+  }
+  void DesiredState::setStrong(bool strong)
+  {
+    m_strong = strong;
+    m_fields |= DesiredStrong;
+  }
+  void DesiredState::setHealth(bool health)
+  {
+    m_health = health;
+    m_fields |= DesiredHealth;
+  }
+  void DesiredState::setMute(bool mute)
+  {
+    m_mute = mute;
+    m_fields |= DesiredMute;
+  }
+  void DesiredState::setMode(OpMode mode)
+  {
+    m_mode = mode;
+    m_fields |= DesiredMode;
+  }
+  void DesiredState::setChosenFanSpeed(FanSpeed speed)
+  {
+    m_fan_speed = speed;
+    m_fields |= DesiredFanSpeed;
+  }
+  void DesiredState::setChosenTemperature(DegreesC temperature)
+  {
+    m_temperature_half = to_half_degrees(temperature);
+    m_fields |= DesiredTemperature;
+  }
+  void DesiredState::setSleepMode(SleepMode sleep)
+  {
+    m_sleep = sleep;
+    m_fields |= DesiredSleep;
+  }
+  void DesiredState::setUpDownFlow(UpDownFlow flow)
+  {
+    m_up_down_flow = flow;
+    m_fields |= DesiredUpDownFlow;
+  }
+  void DesiredState::setLeftRightFlow(LeftRightFlow flow)
+  {
+    m_left_right_flow = flow;
+    m_fields |= DesiredLeftRightFlow;
+  }
+  void DesiredState::clear(uint16_t fields)
+  {
+    m_fields &= ~fields;
+  }
+
+  uint16_t DesiredState::differences(const WytResponse &state) const
+  {
+    uint16_t differences = 0;
+    differences |= state.power != m_power ? DesiredPower : 0;
+    differences |= state.eco != m_eco ? DesiredEco : 0;
+    differences |= state.display != m_display ? DesiredDisplay : 0;
+    differences |= state.strong != m_strong ? DesiredStrong : 0;
+    differences |= state.health != m_health ? DesiredHealth : 0;
+    differences |= state.mute != m_mute ? DesiredMute : 0;
+    differences |= state.mode != m_mode ? DesiredMode : 0;
+    differences |= state.fan_speed != m_fan_speed ? DesiredFanSpeed : 0;
+    differences |= get_chosen_temperature_half(state) != m_temperature_half ? DesiredTemperature : 0;
+    differences |= state.sleep != m_sleep ? DesiredSleep : 0;
+    differences |= state.up_down_flow != m_up_down_flow ? DesiredUpDownFlow : 0;
+    differences |= state.left_right_flow != m_left_right_flow ? DesiredLeftRightFlow : 0;
+    return differences & m_fields & DESIRED_SUPPORTED_FIELDS;
+  }
+
+  uint16_t DesiredState::stageOn(PioneerWYTBase &unit) const
+  {
+    uint16_t fields = differences(unit.getRawState());
+    unit.clearPendingCommand();
+    if (fields & DesiredPower)
+    {
+      unit.setPowerOn(m_power);
+    }
+    if (fields & DesiredMode)
+    {
+      unit.setMode(m_mode);
+    }
+    if (fields & DesiredFanSpeed)
+    {
+      unit.setChosenFanSpeed(m_fan_speed);
+    }
+    if (fields & DesiredTemperature)
+    {
+      unit.setChosenTemperature(from_half_degrees(m_temperature_half));
+    }
+#ifndef PIONEER_UART_BASIC_SETTERS
+    if (fields & DesiredEco)
+    {
+      unit.setEco(m_eco);
+    }
+    if (fields & DesiredDisplay)
+    {
+      unit.setDisplayOn(m_display);
+    }
+    if (fields & DesiredStrong)
+    {
+      unit.setStrong(m_strong);
+    }
+    if (fields & DesiredHealth)
+    {
+      unit.setHealth(m_health);
+    }
+    if (fields & DesiredMute)
+    {
+      unit.setMute(m_mute);
+    }
+    if (fields & DesiredSleep)
+    {
+      unit.setSleepMode(m_sleep);
+    }
+    if (fields & DesiredUpDownFlow)
+    {
+      unit.setUpDownFlow(m_up_down_flow);
+    }
+    if (fields & DesiredLeftRightFlow)
+    {
+      unit.setLeftRightFlow(m_left_right_flow);
+    }
+#endif
+    return fields;
+  }
+
+  Reconciler::Reconciler(OverridePolicy policy, uint32_t min_interval_ms, uint32_t override_hold_ms)
+      : m_policy(policy), m_min_interval_ms(min_interval_ms), m_override_hold_ms(override_hold_ms),
+        m_last_command_ms(0), m_override_since_ms(0), m_has_commanded(false), m_in_sync(false), m_overridden(false)
+  {
+  }
+
+  void Reconciler::setDesired(const DesiredState &desired)
+  {
+    m_desired = desired;
+    m_in_sync = false;
+    m_overridden = false;
+  }
+
+  bool Reconciler::isOverridden(uint32_t now_ms) const
+  {
+    return m_overridden && now_ms - m_override_since_ms < m_override_hold_ms;
+  }
+
+  ReconcileResult Reconciler::stage(PioneerWYTBase &unit, uint32_t now_ms)
+  {
+    // A restored state may be stale, and the unit may have changed since, so wait for a poll before acting on it
+    if (!unit.hasState() || unit.isStateRestored())
+    {
+      return ReconcileResult::NoState;
+    }
+    if (!m_desired.differences(unit.getRawState()))
+    {
+      m_in_sync = true;
+      m_overridden = false;
+      return ReconcileResult::InSync;
+    }
+    // Drifting out of sync without a new desired state means someone changed the unit by hand
+    if (m_in_sync && m_policy == OverridePolicy::RespectManual)
+    {
+      m_overridden = true;
+      m_override_since_ms = now_ms;
+    }
+    m_in_sync = false;
+    if (isOverridden(now_ms))
+    {
+      return ReconcileResult::Overridden;
+    }
+    m_overridden = false;
+    if (m_has_commanded && now_ms - m_last_command_ms < m_min_interval_ms)
+    {
+      return ReconcileResult::RateLimited;
+    }
+    m_desired.stageOn(unit);
+    m_last_command_ms = now_ms;
+    m_has_commanded = true;
+    return ReconcileResult::Staged;
+  }
+}
+#endif
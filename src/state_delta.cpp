@@ -0,0 +1,206 @@
+#include "state_delta.h"
+#include <string.h>
+
+#define DELTA_GROUP_COUNT ((RESPONSE_SIZE + 7) / 8)
+
+namespace pioneer_uart
+{
+  static size_t varint_size(uint32_t value)
+  {
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+      value >>= 7;
+      ++size;
+    }
+    return size;
+  }
+
+  static size_t write_varint(uint32_t value, uint8_t *out)
+  {
+    size_t size = 0;
+    while (value >= 0x80)
+    {
+      out[size++] = static_cast<uint8_t>(value) | 0x80;
+      value >>= 7;
+    }
+    out[size++] = static_cast<uint8_t>(value);
+    return size;
+  }
+
+  static size_t read_varint(const uint8_t *in, size_t length, uint32_t &value)
+  {
+    value = 0;
+    for (size_t idx = 0; idx < length && idx < 5; ++idx)
+    {
+      value |= static_cast<uint32_t>(in[idx] & 0x7f) << (7 * idx);
+      if (!(in[idx] & 0x80))
+      {
+        return idx + 1;
+      }
+    }
+    return 0;
+  }
+
+  DeltaEncoder::DeltaEncoder(uint16_t keyframe_interval)
+      : m_previous_timestamp(0), m_keyframe_interval(keyframe_interval), m_since_keyframe(0), m_has_previous(false)
+  {
+  }
+
+  void DeltaEncoder::reset()
+  {
+    m_has_previous = false;
+  }
+
+  size_t DeltaEncoder::encode(const response::WytResponse &state, uint32_t timestamp, uint8_t *out, size_t capacity)
+  {
+    uint8_t group_mask = 0;
+    uint8_t byte_masks[DELTA_GROUP_COUNT] = {0};
+    size_t changed = 0;
+    size_t group_count = 0;
+    if (m_has_previous)
+    {
+      for (size_t idx = 0; idx < RESPONSE_SIZE; ++idx)
+      {
+        if (state.bytes[idx] != m_previous.bytes[idx])
+        {
+          byte_masks[idx / 8] |= 1 << (idx % 8);
+          ++changed;
+        }
+      }
+      for (size_t group = 0; group < DELTA_GROUP_COUNT; ++group)
+      {
+        if (byte_masks[group])
+        {
+          group_mask |= 1 << group;
+          ++group_count;
+        }
+      }
+    }
+
+    uint32_t elapsed = timestamp - m_previous_timestamp;
+    size_t delta_size = 2 + varint_size(elapsed) + group_count + changed;
+    size_t keyframe_size = 1 + varint_size(timestamp) + RESPONSE_SIZE;
+    size_t size;
+    // A frame where most bytes changed is cheaper sent whole
+    if (!m_has_previous || m_since_keyframe + 1 >= m_keyframe_interval || delta_size >= keyframe_size)
+    {
+      if (capacity < keyframe_size)
+      {
+        return 0;
+      }
+      out[0] = DELTA_KEYFRAME_TAG;
+      size = 1 + write_varint(timestamp, out + 1);
+      memcpy(out + size, state.bytes, RESPONSE_SIZE);
+      size += RESPONSE_SIZE;
+      m_since_keyframe = 0;
+    }
+    else
+    {
+      if (capacity < delta_size)
+      {
+        return 0;
+      }
+      out[0] = DELTA_FRAME_TAG;
+      size = 1 + write_varint(elapsed, out + 1);
+      out[size++] = group_mask;
+      for (size_t group = 0; group < DELTA_GROUP_COUNT; ++group)
+      {
+        if (byte_masks[group])
+        {
+          out[size++] = byte_masks[group];
+        }
+      }
+      for (size_t idx = 0; idx < RESPONSE_SIZE; ++idx)
+      {
+        if (byte_masks[idx / 8] & (1 << (idx % 8)))
+        {
+          out[size++] = state.bytes[idx] ^ m_previous.bytes[idx];
+        }
+      }
+      ++m_since_keyframe;
+    }
+    m_previous = state;
+    m_previous_timestamp = timestamp;
+    m_has_previous = true;
+    return size;
+  }
+
+  DeltaDecoder::DeltaDecoder() : m_previous_timestamp(0), m_has_previous(false) {}
+
+  void DeltaDecoder::reset()
+  {
+    m_has_previous = false;
+  }
+
+  size_t DeltaDecoder::decode(const uint8_t *in, size_t length, response::WytResponse &state, uint32_t &timestamp)
+  {
+    if (length < 2)
+    {
+      return 0;
+    }
+    uint32_t value;
+    size_t size = read_varint(in + 1, length - 1, value);
+    if (!size)
+    {
+      return 0;
+    }
+    size += 1;
+    if (in[0] == DELTA_KEYFRAME_TAG)
+    {
+      if (length - size < RESPONSE_SIZE)
+      {
+        return 0;
+      }
+      memcpy(m_previous.bytes, in + size, RESPONSE_SIZE);
+      m_previous_timestamp = value;
+      size += RESPONSE_SIZE;
+    }
+    else if (in[0] == DELTA_FRAME_TAG && m_has_previous)
+    {
+      if (size >= length)
+      {
+        return 0;
+      }
+      uint8_t group_mask = in[size++];
+      uint8_t byte_masks[DELTA_GROUP_COUNT] = {0};
+      for (size_t group = 0; group < DELTA_GROUP_COUNT; ++group)
+      {
+        if (group_mask & (1 << group))
+        {
+          if (size >= length)
+          {
+            return 0;
+          }
+          byte_masks[group] = in[size++];
+        }
+      }
+      // Check the whole frame is present before touching the previous state
+      size_t changed = 0;
+      for (size_t idx = 0; idx < RESPONSE_SIZE; ++idx)
+      {
+        changed += (byte_masks[idx / 8] >> (idx % 8)) & 1;
+      }
+      if (length - size < changed)
+      {
+        return 0;
+      }
+      for (size_t idx = 0; idx < RESPONSE_SIZE; ++idx)
+      {
+        if (byte_masks[idx / 8] & (1 << (idx % 8)))
+        {
+          m_previous.bytes[idx] ^= in[size++];
+        }
+      }
+      m_previous_timestamp += value;
+    }
+    else
+    {
+      return 0;
+    }
+    m_has_previous = true;
+    state = m_previous;
+    timestamp = m_previous_timestamp;
+    return size;
+  }
+}
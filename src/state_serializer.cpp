@@ -0,0 +1,553 @@
+#include "state_serializer.h"
+#include <string.h>
+
+namespace pioneer_uart
+{
+  namespace serializer
+  {
+    using namespace response;
+
+    enum class Kind : uint8_t
+    {
+      Bool,
+      Integer,
+      /** Fixed point, in tenths */
+      Tenths,
+      /** An enumeration, written by name */
+      Name,
+    };
+
+    enum Field : uint8_t
+    {
+      Power,
+      Eco,
+      Display,
+      Strong,
+      Health,
+      Mute,
+      VerticalFlow,
+      HorizontalFlow,
+      FourWayValveOn,
+      Antifreeze,
+      HeatMode,
+      Mode,
+      ChosenFanSpeed,
+      ChosenTemperature,
+      IndoorTemperature,
+      IndoorHeatExchangerTemperature,
+      OutdoorTemperature,
+      CondenserCoilTemperature,
+      CompressorDischargeTemperature,
+      CompressorFrequency,
+      IndoorFanSpeedField,
+      OutdoorFanSpeed,
+      SupplyVoltage,
+      CurrentUsedAmps,
+      UpDownFlowField,
+      LeftRightFlowField,
+      SleepModeField,
+      FieldCount,
+    };
+
+    struct FieldInfo
+    {
+      const char *key;
+      Kind kind;
+    };
+
+    static const FieldInfo FIELDS[FieldCount] = {
+        {"power", Kind::Bool},
+        {"eco", Kind::Bool},
+        {"display", Kind::Bool},
+        {"strong", Kind::Bool},
+        {"health", Kind::Bool},
+        {"mute", Kind::Bool},
+        {"vertical_flow", Kind::Bool},
+        {"horizontal_flow", Kind::Bool},
+        {"four_way_valve_on", Kind::Bool},
+        {"antifreeze", Kind::Bool},
+        {"heat_mode", Kind::Bool},
+        {"mode", Kind::Name},
+        {"chosen_fan_speed", Kind::Name},
+        {"chosen_temperature", Kind::Tenths},
+        {"indoor_temperature", Kind::Tenths},
+        {"indoor_heat_exchanger_temperature", Kind::Tenths},
+        {"outdoor_temperature", Kind::Integer},
+        {"condenser_coil_temperature", Kind::Integer},
+        {"compressor_discharge_temperature", Kind::Integer},
+        {"compressor_frequency", Kind::Integer},
+        {"indoor_fan_speed", Kind::Name},
+        {"outdoor_fan_speed", Kind::Integer},
+        {"supply_voltage", Kind::Integer},
+        {"current_used_amps", Kind::Integer},
+        {"up_down_flow", Kind::Name},
+        {"left_right_flow", Kind::Name},
+        {"sleep_mode", Kind::Name},
+    };
+
+    /** Returns the field's decoded value: the raw enumeration value, integer, or tenths, depending on its kind */
+    static int16_t field_value(const WytResponse &state, uint8_t field)
+    {
+      switch (field)
+      {
+      case Power:
+        return state.power;
+      case Eco:
+        return state.eco;
+      case Display:
+        return state.display;
+      case Strong:
+        return state.strong;
+      case Health:
+        return state.health;
+      case Mute:
+        return state.mute;
+      case VerticalFlow:
+        return state.vertical_flow;
+      case HorizontalFlow:
+        return state.horizontal_flow;
+      case FourWayValveOn:
+        return state.four_way_valve_on;
+      case Antifreeze:
+        return state.antifreeze;
+      case HeatMode:
+        return state.heat_mode;
+      case Mode:
+        return static_cast<uint8_t>(state.mode);
+      case ChosenFanSpeed:
+        return static_cast<uint8_t>(state.fan_speed);
+      case ChosenTemperature:
+        return get_chosen_temperature_half(state) * 5;
+      case IndoorTemperature:
+        return indoor_sensor_decidegrees_c(state.indoor_temp_base);
+      case IndoorHeatExchangerTemperature:
+        return indoor_sensor_decidegrees_c(state.indoor_heat_exchanger_temp);
+      case OutdoorTemperature:
+        return state.outdoor_temp;
+      case CondenserCoilTemperature:
+        return state.condenser_coil_temp;
+      case CompressorDischargeTemperature:
+        return state.compressor_discharge_temp;
+      case CompressorFrequency:
+        return state.compressor_frequency;
+      case IndoorFanSpeedField:
+        return static_cast<uint8_t>(state.indoor_fan_speed);
+      case OutdoorFanSpeed:
+        return state.outdoor_fan_speed;
+      case SupplyVoltage:
+        return state.supply_voltage;
+      case CurrentUsedAmps:
+        return state.current_used_amps;
+      case UpDownFlowField:
+        return static_cast<uint8_t>(state.up_down_flow);
+      case LeftRightFlowField:
+        return static_cast<uint8_t>(state.left_right_flow);
+      case SleepModeField:
+        return static_cast<uint8_t>(state.sleep);
+      }
+      return 0;
+    }
+
+    /** Returns the name for an enumeration field's value, or `nullptr` if the value is not a known one */
+    static const char *value_name(uint8_t field, int16_t value)
+    {
+      switch (field)
+      {
+      case Mode:
+        switch (static_cast<OpMode>(value))
+        {
+        case OpMode::Cool:
+          return "cool";
+        case OpMode::Fan:
+          return "fan";
+        case OpMode::Dehumidify:
+          return "dehumidify";
+        case OpMode::Heat:
+          return "heat";
+        case OpMode::Auto:
+          return "auto";
+        }
+        break;
+      case ChosenFanSpeed:
+        switch (static_cast<FanSpeed>(value))
+        {
+        case FanSpeed::Auto:
+          return "auto";
+        case FanSpeed::Low:
+          return "low";
+        case FanSpeed::Medium:
+          return "medium";
+        case FanSpeed::MidLow:
+          return "mid_low";
+        case FanSpeed::MidHigh:
+          return "mid_high";
+        case FanSpeed::High:
+          return "high";
+        }
+        break;
+      case IndoorFanSpeedField:
+        switch (static_cast<IndoorFanSpeed>(value))
+        {
+        case IndoorFanSpeed::Off:
+          return "off";
+        case IndoorFanSpeed::Low:
+          return "low";
+        case IndoorFanSpeed::Medium:
+          return "medium";
+        case IndoorFanSpeed::High:
+          return "high";
+        }
+        break;
+      case UpDownFlowField:
+        switch (static_cast<UpDownFlow>(value))
+        {
+        case UpDownFlow::Auto:
+          return "auto";
+        case UpDownFlow::TopFix:
+          return "top_fix";
+        case UpDownFlow::UpperFix:
+          return "upper_fix";
+        case UpDownFlow::MiddleFix:
+          return "middle_fix";
+        case UpDownFlow::LowerFix:
+          return "lower_fix";
+        case UpDownFlow::BottomFix:
+          return "bottom_fix";
+        case UpDownFlow::UpDownFlow:
+          return "up_down_flow";
+        case UpDownFlow::UpFlow:
+          return "up_flow";
+        case UpDownFlow::DownFlow:
+          return "down_flow";
+        }
+        break;
+      case LeftRightFlowField:
+        switch (static_cast<LeftRightFlow>(value))
+        {
+        case LeftRightFlow::Auto:
+          return "auto";
+        case LeftRightFlow::LeftFix:
+          return "left_fix";
+        case LeftRightFlow::MiddleLeftFix:
+          return "middle_left_fix";
+        case LeftRightFlow::MiddleFix:
+          return "middle_fix";
+        case LeftRightFlow::MiddleRightFix:
+          return "middle_right_fix";
+        case LeftRightFlow::RightFix:
+          return "right_fix";
+        case LeftRightFlow::LeftRightFlow:
+          return "left_right_flow";
+        case LeftRightFlow::LeftFlow:
+          return "left_flow";
+        case LeftRightFlow::MiddleFlow:
+          return "middle_flow";
+        case LeftRightFlow::RightFlow:
+          return "right_flow";
+        }
+        break;
+      case SleepModeField:
+        switch (static_cast<SleepMode>(value))
+        {
+        case SleepMode::Off:
+          return "off";
+        case SleepMode::Standard:
+          return "standard";
+        case SleepMode::Elderly:
+          return "elderly";
+        case SleepMode::Child:
+          return "child";
+        }
+        break;
+      }
+      return nullptr;
+    }
+
+    /** Appends to a fixed buffer, remembering if anything failed to fit */
+    class JsonWriter
+    {
+    public:
+      JsonWriter(char *out, size_t capacity) : m_out(out), m_capacity(capacity), m_length(0), m_overflow(false) {}
+
+      void put(char c)
+      {
+        if (m_length + 1 < m_capacity)
+        {
+          m_out[m_length++] = c;
+        }
+        else
+        {
+          m_overflow = true;
+        }
+      }
+      void put(const char *text)
+      {
+        while (*text)
+        {
+          put(*text++);
+        }
+      }
+      void putInteger(int32_t value)
+      {
+        if (value < 0)
+        {
+          put('-');
+          value = -value;
+        }
+        char digits[10];
+        size_t count = 0;
+        do
+        {
+          digits[count++] = '0' + value % 10;
+          value /= 10;
+        } while (value);
+        while (count)
+        {
+          put(digits[--count]);
+        }
+      }
+      void putTenths(int32_t tenths)
+      {
+        if (tenths < 0)
+        {
+          put('-');
+          tenths = -tenths;
+        }
+        putInteger(tenths / 10);
+        put('.');
+        put('0' + tenths % 10);
+      }
+      size_t finish()
+      {
+        if (m_overflow || m_capacity == 0)
+        {
+          return 0;
+        }
+        m_out[m_length] = '\0';
+        return m_length;
+      }
+
+    private:
+      char *m_out;
+      size_t m_capacity;
+      size_t m_length;
+      bool m_overflow;
+    };
+
+    class CborWriter
+    {
+    public:
+      CborWriter(uint8_t *out, size_t capacity) : m_out(out), m_capacity(capacity), m_length(0), m_overflow(false) {}
+
+      void putHead(uint8_t major, uint32_t value)
+      {
+        major <<= 5;
+        if (value < 24)
+        {
+          put(major | value);
+        }
+        else if (value <= 0xff)
+        {
+          put(major | 24);
+          put(value);
+        }
+        else if (value <= 0xffff)
+        {
+          put(major | 25);
+          put(value >> 8);
+          put(value);
+        }
+        else
+        {
+          put(major | 26);
+          put(value >> 24);
+          put(value >> 16);
+          put(value >> 8);
+          put(value);
+        }
+      }
+      void putText(const char *text)
+      {
+        size_t length = strlen(text);
+        putHead(3, length);
+        for (size_t idx = 0; idx < length; ++idx)
+        {
+          put(text[idx]);
+        }
+      }
+      void putBool(bool value)
+      {
+        put(value ? 0xf5 : 0xf4);
+      }
+      void putInteger(int32_t value)
+      {
+        if (value < 0)
+        {
+          putHead(1, -1 - value);
+        }
+        else
+        {
+          putHead(0, value);
+        }
+      }
+      void putFloat(float value)
+      {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        put(0xfa);
+        put(bits >> 24);
+        put(bits >> 16);
+        put(bits >> 8);
+        put(bits);
+      }
+      size_t finish()
+      {
+        return m_overflow ? 0 : m_length;
+      }
+
+    private:
+      uint8_t *m_out;
+      size_t m_capacity;
+      size_t m_length;
+      bool m_overflow;
+
+      void put(uint8_t byte)
+      {
+        if (m_length < m_capacity)
+        {
+          m_out[m_length++] = byte;
+        }
+        else
+        {
+          m_overflow = true;
+        }
+      }
+    };
+
+    static inline bool should_write(uint8_t field, int16_t value, const WytResponse *previous)
+    {
+      return !previous || field_value(*previous, field) != value;
+    }
+
+    size_t to_json(const WytResponse &state, char *out, size_t capacity, const WytResponse *previous)
+    {
+      JsonWriter writer(out, capacity);
+      bool first = true;
+      writer.put('{');
+      for (uint8_t field = 0; field < FieldCount; ++field)
+      {
+        int16_t value = field_value(state, field);
+        if (!should_write(field, value, previous))
+        {
+          continue;
+        }
+        if (!first)
+        {
+          writer.put(',');
+        }
+        first = false;
+        writer.put('"');
+        writer.put(FIELDS[field].key);
+        writer.put("\":");
+        switch (FIELDS[field].kind)
+        {
+        case Kind::Bool:
+          writer.put(value ? "true" : "false");
+          break;
+        case Kind::Integer:
+          writer.putInteger(value);
+          break;
+        case Kind::Tenths:
+          writer.putTenths(value);
+          break;
+        case Kind::Name:
+        {
+          const char *name = value_name(field, value);
+          if (name)
+          {
+            writer.put('"');
+            writer.put(name);
+            writer.put('"');
+          }
+          else
+          {
+            writer.putInteger(value);
+          }
+          break;
+        }
+        }
+      }
+      writer.put('}');
+      return writer.finish();
+    }
+
+    size_t to_cbor(const WytResponse &state, uint8_t *out, size_t capacity, const WytResponse *previous)
+    {
+      CborWriter writer(out, capacity);
+      uint8_t count = 0;
+      for (uint8_t field = 0; field < FieldCount; ++field)
+      {
+        count += should_write(field, field_value(state, field), previous);
+      }
+      writer.putHead(5, count);
+      for (uint8_t field = 0; field < FieldCount; ++field)
+      {
+        int16_t value = field_value(state, field);
+        if (!should_write(field, value, previous))
+        {
+          continue;
+        }
+        writer.putText(FIELDS[field].key);
+        switch (FIELDS[field].kind)
+        {
+        case Kind::Bool:
+          writer.putBool(value);
+          break;
+        case Kind::Integer:
+          writer.putInteger(value);
+          break;
+        case Kind::Tenths:
+          writer.putFloat(value / 10.0f);
+          break;
+        case Kind::Name:
+        {
+          const char *name = value_name(field, value);
+          if (name)
+          {
+            writer.putText(name);
+          }
+          else
+          {
+            writer.putInteger(value);
+          }
+          break;
+        }
+        }
+      }
+      return writer.finish();
+    }
+
+    bool from_name(const char *key, const char *name, size_t length, uint8_t &value)
+    {
+      for (uint8_t field = 0; field < FieldCount; ++field)
+      {
+        if (FIELDS[field].kind != Kind::Name || strcmp(FIELDS[field].key, key) != 0)
+        {
+          continue;
+        }
+        // Enumerations are single bytes, so trying every value is cheap enough for parsing the odd command
+        for (uint16_t candidate = 0; candidate <= 0xff; ++candidate)
+        {
+          const char *candidate_name = value_name(field, candidate);
+          if (candidate_name && strlen(candidate_name) == length && memcmp(candidate_name, name, length) == 0)
+          {
+            value = candidate;
+            return true;
+          }
+        }
+        return false;
+      }
+      return false;
+    }
+  }
+}
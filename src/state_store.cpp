@@ -0,0 +1,105 @@
+#include "state_store.h"
+#include <string.h>
+#ifdef USE_ARDUINO
+#include <EEPROM.h>
+#elif !defined(__AVR__)
+#include <stdio.h>
+#endif
+
+namespace pioneer_uart
+{
+  static uint8_t record_checksum(const StateRecord &record)
+  {
+    uint8_t result = 0;
+    for (size_t idx = 0; idx < STATE_RECORD_SIZE - 1; ++idx)
+    {
+      result ^= record.bytes[idx];
+    }
+    return result;
+  }
+
+  bool StateStore::load(response::WytResponse &state)
+  {
+    StateRecord record;
+    if (!readRecord(record.bytes))
+    {
+      return false;
+    }
+    if (record.magic != STATE_RECORD_MAGIC || record.version != STATE_RECORD_VERSION)
+    {
+      return false;
+    }
+    if (record.checksum != record_checksum(record))
+    {
+      return false;
+    }
+    state = response::from_bytes(record.state);
+    return true;
+  }
+
+  bool StateStore::save(const response::WytResponse &state)
+  {
+    StateRecord record;
+    record.magic = STATE_RECORD_MAGIC;
+    record.version = STATE_RECORD_VERSION;
+    memcpy(record.state, state.bytes, RESPONSE_SIZE);
+    record.checksum = record_checksum(record);
+    return writeRecord(record.bytes);
+  }
+
+#ifdef USE_ARDUINO
+  EepromStateStore::EepromStateStore(int offset) : m_offset(offset) {}
+
+  bool EepromStateStore::readRecord(uint8_t bytes[STATE_RECORD_SIZE])
+  {
+    for (size_t idx = 0; idx < STATE_RECORD_SIZE; ++idx)
+    {
+      bytes[idx] = EEPROM.read(m_offset + idx);
+    }
+    return true;
+  }
+
+  bool EepromStateStore::writeRecord(const uint8_t bytes[STATE_RECORD_SIZE])
+  {
+    for (size_t idx = 0; idx < STATE_RECORD_SIZE; ++idx)
+    {
+      // Skip unchanged cells to save wear on boards with real EEPROM
+      if (EEPROM.read(m_offset + idx) != bytes[idx])
+      {
+        EEPROM.write(m_offset + idx, bytes[idx]);
+      }
+    }
+#if defined(ESP8266) || defined(ESP32)
+    return EEPROM.commit();
+#else
+    return true;
+#endif
+  }
+#elif !defined(__AVR__)
+  FileStateStore::FileStateStore(const char *path) : m_path(path) {}
+
+  bool FileStateStore::readRecord(uint8_t bytes[STATE_RECORD_SIZE])
+  {
+    FILE *file = fopen(m_path, "rb");
+    if (!file)
+    {
+      return false;
+    }
+    size_t bytes_read = fread(bytes, 1, STATE_RECORD_SIZE, file);
+    fclose(file);
+    return bytes_read == STATE_RECORD_SIZE;
+  }
+
+  bool FileStateStore::writeRecord(const uint8_t bytes[STATE_RECORD_SIZE])
+  {
+    FILE *file = fopen(m_path, "wb");
+    if (!file)
+    {
+      return false;
+    }
+    size_t bytes_written = fwrite(bytes, 1, STATE_RECORD_SIZE, file);
+    bool closed = fclose(file) == 0;
+    return bytes_written == STATE_RECORD_SIZE && closed;
+  }
+#endif
+}
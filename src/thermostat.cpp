@@ -0,0 +1,147 @@
+#include "thermostat.h"
+
+#ifndef PIONEER_UART_READ_ONLY
+namespace pioneer_uart
+{
+  static inline int16_t to_tenths(DegreesC temperature)
+  {
+#ifdef PIONEER_UART_FIXED_POINT
+    return temperature;
+#else
+    return static_cast<int16_t>(temperature * 10 + (temperature < 0 ? -0.5f : 0.5f));
+#endif
+  }
+
+  static inline DegreesC from_tenths(int16_t tenths)
+  {
+#ifdef PIONEER_UART_FIXED_POINT
+    return tenths;
+#else
+    return tenths / 10.0f;
+#endif
+  }
+
+  Thermostat::Thermostat(DegreesC target, DegreesC hysteresis, uint8_t budget_burst, uint32_t budget_interval_ms,
+                         uint32_t max_sample_age_ms)
+      : m_target_tenths(to_tenths(target)), m_hysteresis_tenths(to_tenths(hysteresis)), m_external_tenths(0),
+        m_wanted_tenths(0), m_bias_scaled(0), m_budget_interval_ms(budget_interval_ms),
+        m_max_sample_age_ms(max_sample_age_ms), m_sample_ms(0), m_refill_ms(0), m_budget_burst(budget_burst),
+        m_budget(budget_burst), m_has_sample(false), m_has_new_sample(false), m_has_bias(false)
+  {
+  }
+
+  void Thermostat::setTarget(DegreesC target)
+  {
+    m_target_tenths = to_tenths(target);
+  }
+
+  DegreesC Thermostat::getTarget() const
+  {
+    return from_tenths(m_target_tenths);
+  }
+
+  void Thermostat::setExternalTemperature(DegreesC temperature, uint32_t now_ms)
+  {
+    m_external_tenths = to_tenths(temperature);
+    m_sample_ms = now_ms;
+    m_has_sample = true;
+    m_has_new_sample = true;
+  }
+
+  DegreesC Thermostat::getBias() const
+  {
+    return from_tenths(static_cast<int16_t>(m_bias_scaled / (1 << THERMOSTAT_BIAS_SMOOTHING_SHIFT)));
+  }
+
+  DegreesC Thermostat::getWantedSetpoint() const
+  {
+    return from_tenths(m_wanted_tenths);
+  }
+
+  uint8_t Thermostat::getBudget(uint32_t now_ms)
+  {
+    if (m_budget >= m_budget_burst)
+    {
+      // A full bucket earns nothing, so the next command starts its refill from when it is sent
+      m_refill_ms = now_ms;
+      return m_budget;
+    }
+    uint32_t earned = m_budget_interval_ms ? (now_ms - m_refill_ms) / m_budget_interval_ms : m_budget_burst;
+    if (earned >= static_cast<uint32_t>(m_budget_burst - m_budget))
+    {
+      m_budget = m_budget_burst;
+      m_refill_ms = now_ms;
+    }
+    else
+    {
+      m_budget += earned;
+      m_refill_ms += earned * m_budget_interval_ms;
+    }
+    return m_budget;
+  }
+
+  ThermostatResult Thermostat::stage(PioneerWYTBase &unit, uint32_t now_ms)
+  {
+    // A restored state may be stale, and its indoor reading would skew the bias, so wait for a poll
+    if (!unit.hasState() || unit.isStateRestored())
+    {
+      return ThermostatResult::NoState;
+    }
+    if (!m_has_sample || now_ms - m_sample_ms > m_max_sample_age_ms)
+    {
+      return ThermostatResult::NoSample;
+    }
+    const WytResponse &state = unit.getRawState();
+    // Each external reading is averaged in once, so the smoothing does not depend on how often the unit is polled
+    if (m_has_new_sample)
+    {
+      int16_t bias_tenths = indoor_sensor_decidegrees_c(state.indoor_temp_base) - m_external_tenths;
+      if (!m_has_bias)
+      {
+        m_bias_scaled = static_cast<int32_t>(bias_tenths) << THERMOSTAT_BIAS_SMOOTHING_SHIFT;
+        m_has_bias = true;
+      }
+      else
+      {
+        m_bias_scaled += bias_tenths - m_bias_scaled / (1 << THERMOSTAT_BIAS_SMOOTHING_SHIFT);
+      }
+      m_has_new_sample = false;
+    }
+    if (!state.power || (state.mode != OpMode::Heat && state.mode != OpMode::Cool && state.mode != OpMode::Auto))
+    {
+      return ThermostatResult::Idle;
+    }
+
+    int16_t wanted = m_target_tenths + static_cast<int16_t>(m_bias_scaled / (1 << THERMOSTAT_BIAS_SMOOTHING_SHIFT));
+    if (wanted < THERMOSTAT_MIN_SETPOINT_HALF * 5)
+    {
+      wanted = THERMOSTAT_MIN_SETPOINT_HALF * 5;
+    }
+    else if (wanted > THERMOSTAT_MAX_SETPOINT_HALF * 5)
+    {
+      wanted = THERMOSTAT_MAX_SETPOINT_HALF * 5;
+    }
+    m_wanted_tenths = wanted;
+
+    // Half degree steps are 5 tenths apart, so the nearest step changes 2.5 tenths away from the current one
+    int16_t current = get_chosen_temperature_half(state) * 5;
+    int16_t distance = wanted > current ? wanted - current : current - wanted;
+    if (distance * 2 < 5 + m_hysteresis_tenths * 2)
+    {
+      return ThermostatResult::Holding;
+    }
+    uint8_t setpoint_half = static_cast<uint8_t>((wanted * 2 + 5) / 10);
+    if (setpoint_half * 5 == current)
+    {
+      return ThermostatResult::Holding;
+    }
+    if (getBudget(now_ms) == 0)
+    {
+      return ThermostatResult::OutOfBudget;
+    }
+    --m_budget;
+    unit.setChosenTemperature(from_half_degrees(setpoint_half));
+    return ThermostatResult::Staged;
+  }
+}
+#endif
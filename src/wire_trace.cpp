@@ -0,0 +1,94 @@
+#include "wire_trace.h"
+#include <string.h>
+#ifdef USE_ARDUINO
+#include <Arduino.h>
+#else
+#include <time.h>
+#endif
+
+namespace pioneer_uart
+{
+  static inline uint32_t trace_timestamp()
+  {
+#ifdef USE_ARDUINO
+    return micros();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint32_t>(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+#endif
+  }
+
+  WireTracer::WireTracer(uint8_t *buffer, size_t size)
+      : m_buffer(buffer), m_size(size), m_head(0), m_used(0)
+  {
+  }
+
+  void WireTracer::record(TraceDirection direction, const uint8_t *bytes, uint8_t length)
+  {
+    size_t needed = TRACE_RECORD_HEADER_SIZE + length;
+    if (needed > m_size)
+    {
+      return;
+    }
+    // Make room by dropping the oldest records whole
+    while (m_size - m_used < needed)
+    {
+      size_t oldest = TRACE_RECORD_HEADER_SIZE + at(TRACE_RECORD_HEADER_SIZE - 1);
+      m_head = (m_head + oldest) % m_size;
+      m_used -= oldest;
+    }
+    uint32_t timestamp = trace_timestamp();
+    uint8_t header[TRACE_RECORD_HEADER_SIZE] = {
+        static_cast<uint8_t>(timestamp),
+        static_cast<uint8_t>(timestamp >> 8),
+        static_cast<uint8_t>(timestamp >> 16),
+        static_cast<uint8_t>(timestamp >> 24),
+        static_cast<uint8_t>(direction),
+        length,
+    };
+    size_t tail = (m_head + m_used) % m_size;
+    put(tail, header, TRACE_RECORD_HEADER_SIZE);
+    put((tail + TRACE_RECORD_HEADER_SIZE) % m_size, bytes, length);
+    m_used += needed;
+  }
+
+  size_t WireTracer::dump(uint8_t *out, size_t size) const
+  {
+    size_t length = 0;
+    // Stop at the last record that fits entirely
+    while (length < m_used)
+    {
+      size_t record_length = TRACE_RECORD_HEADER_SIZE + at(length + TRACE_RECORD_HEADER_SIZE - 1);
+      if (length + record_length > size)
+      {
+        break;
+      }
+      length += record_length;
+    }
+    size_t first = m_size - m_head < length ? m_size - m_head : length;
+    memcpy(out, m_buffer + m_head, first);
+    memcpy(out + first, m_buffer, length - first);
+    return length;
+  }
+
+  size_t WireTracer::used() const { return m_used; }
+
+  void WireTracer::clear()
+  {
+    m_head = 0;
+    m_used = 0;
+  }
+
+  void WireTracer::put(size_t position, const uint8_t *bytes, size_t length)
+  {
+    size_t first = m_size - position < length ? m_size - position : length;
+    memcpy(m_buffer + position, bytes, first);
+    memcpy(m_buffer, bytes + first, length - first);
+  }
+
+  uint8_t WireTracer::at(size_t offset) const
+  {
+    return m_buffer[(m_head + offset) % m_size];
+  }
+}
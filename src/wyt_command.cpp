@@ -52,6 +52,8 @@ namespace pioneer_uart
     WytSetStateCommand from_response(const response::WytResponse &response)
     {
       WytSetStateCommand command;
+      // Bytes the response has no value for are sent as zero, not whatever was on the stack
+      memset(command.bytes, 0, STATE_COMMAND_SIZE);
       WytCommandHeader header = new_header(Source::Controller, Command::SetState, 0x1d);
       command.header = header;
       command.eco = response.eco;
@@ -92,6 +94,9 @@ namespace pioneer_uart
       case response::FanSpeed::Low:
         command.fan_speed = FanSpeed::Low;
         break;
+      case response::FanSpeed::Medium:
+        command.fan_speed = FanSpeed::Medium;
+        break;
       case response::FanSpeed::MidHigh:
         command.fan_speed = FanSpeed::MidHigh;
         break;
@@ -99,7 +104,7 @@ namespace pioneer_uart
         command.fan_speed = FanSpeed::MidLow;
         break;
       }
-      set_chosen_temperature(command, response::get_chosen_temperature_degrees_c(response));
+      set_chosen_temperature_half(command, response::get_chosen_temperature_half(response));
       command.unknown8[0] = 0x80;
       command.sleep = static_cast<SleepMode>(response.sleep);
       command.up_down_flow = static_cast<UpDownFlow>(response.up_down_flow);
@@ -1,4 +1,5 @@
 #include "wyt_response.h"
+#include <stddef.h>
 #include <string.h>
 
 namespace pioneer_uart
@@ -11,5 +12,43 @@ namespace pioneer_uart
       memcpy(response.bytes, buffer, RESPONSE_SIZE);
       return response;
     }
+
+    uint8_t checksum(const WytResponse &response)
+    {
+      uint8_t result = 0;
+      for (size_t idx = 0; idx < RESPONSE_SIZE - 1; ++idx)
+      {
+        result ^= response.bytes[idx];
+      }
+      return result;
+    }
+
+    bool is_valid(const WytResponse &response)
+    {
+      // The MCU answers with source bytes `01 00`, which `Source` reads as `Controller` on little-endian targets.
+      // As in commands, the length byte leaves out the 5-byte header and the checksum.
+      return response.magic == 0xbb && response.bytes[1] == 0x01 && response.bytes[2] == 0x00 &&
+             (response.command == Command::ResponseToQuery || response.command == Command::ResponseToCommand) &&
+             response.command_length == RESPONSE_SIZE - 6 && response.bytes[RESPONSE_SIZE - 1] == checksum(response);
+    }
+
+    bool has_same_settings(const WytResponse &a, const WytResponse &b)
+    {
+      return a.power == b.power &&
+             a.eco == b.eco &&
+             a.display == b.display &&
+             a.strong == b.strong &&
+             a.health == b.health &&
+             a.mute == b.mute &&
+             a.mode == b.mode &&
+             a.fan_speed == b.fan_speed &&
+             a.set_temperature_whole == b.set_temperature_whole &&
+             a.set_temperature_half == b.set_temperature_half &&
+             a.antifreeze == b.antifreeze &&
+             a.vertical_flow == b.vertical_flow &&
+             a.sleep == b.sleep &&
+             a.up_down_flow == b.up_down_flow &&
+             a.left_right_flow == b.left_right_flow;
+    }
   }
 }
\ No newline at end of file
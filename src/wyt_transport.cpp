@@ -0,0 +1,146 @@
+#include "wyt_transport.h"
+#include <string.h>
+#if !defined(USE_ARDUINO) && (defined(__unix__) || defined(__APPLE__))
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace pioneer_uart
+{
+#if !defined(USE_ARDUINO) && (defined(__unix__) || defined(__APPLE__))
+  PosixFdTransport::PosixFdTransport(int fd, uint32_t timeout_ms) : m_fd(fd), m_timeout_ms(timeout_ms) {}
+
+  size_t PosixFdTransport::write(const uint8_t *bytes, size_t length)
+  {
+    size_t written = 0;
+    while (written < length)
+    {
+      ssize_t result = ::write(m_fd, bytes + written, length - written);
+      if (result < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        break;
+      }
+      written += result;
+    }
+    return written;
+  }
+
+  void PosixFdTransport::flush()
+  {
+    // Not a tty (e.g. a pipe or socket) is fine; there is nothing to drain
+    tcdrain(m_fd);
+  }
+
+  size_t PosixFdTransport::read(uint8_t *bytes, size_t length)
+  {
+    // poll() takes an int, where a negative timeout would mean waiting forever
+    int timeout_ms = m_timeout_ms > INT_MAX ? INT_MAX : static_cast<int>(m_timeout_ms);
+    size_t bytes_read = 0;
+    while (bytes_read < length)
+    {
+      struct pollfd readable = {m_fd, POLLIN, 0};
+      int ready = poll(&readable, 1, timeout_ms);
+      if (ready < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (ready <= 0)
+      {
+        break;
+      }
+      ssize_t result = ::read(m_fd, bytes + bytes_read, length - bytes_read);
+      if (result < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (result <= 0)
+      {
+        break;
+      }
+      bytes_read += result;
+    }
+    return bytes_read;
+  }
+
+  int PosixFdTransport::openSerialPort(const char *path)
+  {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+      return -1;
+    }
+    struct termios options;
+    if (tcgetattr(fd, &options) != 0)
+    {
+      close(fd);
+      return -1;
+    }
+    cfmakeraw(&options);
+    cfsetispeed(&options, B9600);
+    cfsetospeed(&options, B9600);
+    options.c_cflag |= PARENB | CLOCAL | CREAD;
+    options.c_cflag &= ~(PARODD | CSTOPB);
+    if (tcsetattr(fd, TCSANOW, &options) != 0)
+    {
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+#endif
+
+  LoopbackTransport::LoopbackTransport() : m_received_start(0), m_received_end(0), m_sent_length(0), m_timeout_ms(0) {}
+
+  size_t LoopbackTransport::write(const uint8_t *bytes, size_t length)
+  {
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+      if (m_sent_length + idx < LOOPBACK_BUFFER_SIZE)
+      {
+        m_sent[m_sent_length + idx] = bytes[idx];
+      }
+    }
+    m_sent_length += length;
+    return length;
+  }
+
+  size_t LoopbackTransport::read(uint8_t *bytes, size_t length)
+  {
+    size_t available = m_received_end - m_received_start;
+    size_t bytes_read = length < available ? length : available;
+    memcpy(bytes, m_received + m_received_start, bytes_read);
+    m_received_start += bytes_read;
+    if (m_received_start == m_received_end)
+    {
+      m_received_start = 0;
+      m_received_end = 0;
+    }
+    return bytes_read;
+  }
+
+  bool LoopbackTransport::queueReceived(const uint8_t *bytes, size_t length)
+  {
+    if (m_received_start > 0)
+    {
+      // Compact, so the free space is all at the end
+      memmove(m_received, m_received + m_received_start, m_received_end - m_received_start);
+      m_received_end -= m_received_start;
+      m_received_start = 0;
+    }
+    if (LOOPBACK_BUFFER_SIZE - m_received_end < length)
+    {
+      return false;
+    }
+    memcpy(m_received + m_received_end, bytes, length);
+    m_received_end += length;
+    return true;
+  }
+}